@@ -1,504 +1,331 @@
 #include "header/animated_model.h"
-#include "header/stb_image.h"
 #include <iostream>
-#include <fstream>
+#include <algorithm>
 
-AnimatedModel::AnimatedModel(const std::string& path) {
-    loadModel(path);
+AnimatedModelInstance::AnimatedModelInstance(std::shared_ptr<const AnimatedModelAsset> asset)
+    : m_Asset(std::move(asset)) {
+    // Only the pose buffers are allocated here, mesh, skeleton and clips are shared
+    m_FinalBoneMatrices.resize(std::max(m_Asset->m_BoneCounter, 1), glm::mat4(1.0f));
+    m_Pose.resize(m_Asset->m_Skeleton.size());
+    m_Pose.setToBindPose(m_Asset->m_Skeleton);
+    m_GlobalTransforms.resize(m_Asset->m_Skeleton.size(), glm::mat4(1.0f));
+    
+    if (m_Asset->getClipCount() > 0) {
+        setAnimation(0);
+    }
 }
 
-void AnimatedModel::loadModel(const std::string& path) {
-    // Check if file exists
-    std::ifstream fileCheck(path);
-    if (!fileCheck.good()) {
-        std::cout << "ERROR::ASSIMP:: File not found: " << path << std::endl;
-        return;
-    }
-    fileCheck.close();
-    
-    // Import flags optimized for Mixamo FBX files
-    unsigned int importFlags = aiProcess_Triangulate 
-                             | aiProcess_GenSmoothNormals 
-                             | aiProcess_FlipUVs 
-                             | aiProcess_CalcTangentSpace
-                             | aiProcess_LimitBoneWeights;  // Limit bone weights for better performance
-    
-    // Configure FBX importer settings for Mixamo files
-    m_Importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_ANIMATIONS, true);
-    m_Importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_WEIGHTS, true);
-    m_Importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_PRESERVE_PIVOTS, false);  // Mixamo doesn't need this
-    m_Importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_STRICT_MODE, false);  // Allow different FBX versions
-    
-    std::cout << "Loading FBX file: " << path << std::endl;
-    m_scene = m_Importer.ReadFile(path, importFlags);
-    
-    if (!m_scene) {
-        std::string errorString = m_Importer.GetErrorString();
-        if (errorString.empty()) {
-            errorString = "Unknown error - file may be corrupted or unsupported format";
-        }
-        std::cout << "ERROR::ASSIMP:: Failed to load file: " << path << std::endl;
-        std::cout << "ERROR::ASSIMP:: " << errorString << std::endl;
-        return;
-    }
-    
-    if (m_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) {
-        std::cout << "WARNING::ASSIMP:: Scene is incomplete: " << m_Importer.GetErrorString() << std::endl;
-    }
-    
-    if (!m_scene->mRootNode) {
-        std::cout << "ERROR::ASSIMP:: Scene has no root node" << std::endl;
-        return;
-    }
-    
-    std::cout << "FBX file loaded successfully!" << std::endl;
-    std::cout << "  - Meshes: " << m_scene->mNumMeshes << std::endl;
-    std::cout << "  - Animations: " << m_scene->mNumAnimations << std::endl;
-    std::cout << "  - Materials: " << m_scene->mNumMaterials << std::endl;
-    
-    // Initialize bone matrices (increase to 200 for safety with Mixamo)
-    m_FinalBoneMatrices.resize(200, glm::mat4(1.0f)); // Reserve space for 200 bones
-    
-    // Set current animation if available
-    if (m_scene->mNumAnimations > 0) {
-        m_CurrentAnimation = m_scene->mAnimations[0];
-        std::cout << "  - Animation name: " << m_CurrentAnimation->mName.C_Str() << std::endl;
-        std::cout << "  - Animation duration: " << m_CurrentAnimation->mDuration << " ticks" << std::endl;
-        std::cout << "  - Animation ticks per second: " << m_CurrentAnimation->mTicksPerSecond << std::endl;
-        std::cout << "  - Animation channels: " << m_CurrentAnimation->mNumChannels << std::endl;
-    } else {
-        std::cout << "WARNING:: No animations found in FBX file!" << std::endl;
-    }
-    
-    processNode(m_scene->mRootNode, m_scene);
-    setupMesh();
-    
-    std::cout << "Model processed: " << vertices.size() << " vertices, " << indices.size() << " indices" << std::endl;
-    std::cout << "Bones loaded: " << m_BoneCounter << std::endl;
+void AnimatedModelInstance::render(const BonePalette& palette) {
+    m_Asset->draw(palette);
 }
 
-void AnimatedModel::processNode(aiNode* node, const aiScene* scene) {
-    // Process each mesh located at the current node
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        processMesh(mesh, scene);
-    }
-    
-    // Recursively process each of the children nodes
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
-    }
+float ClipLayer::weightAt(float time) const {
+    if (fadeDuration <= 0.0f || time >= fadeStart + fadeDuration) return targetWeight;
+    float t = glm::clamp((time - fadeStart) / fadeDuration, 0.0f, 1.0f);
+    return startWeight + (targetWeight - startWeight) * t;
 }
 
-void AnimatedModel::processMesh(aiMesh* mesh, const aiScene* scene) {
-    // Process vertices
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        Vertex vertex;
-        setVertexBoneDataToDefault(vertex);
-        
-        // Position
-        vertex.Position.x = mesh->mVertices[i].x;
-        vertex.Position.y = mesh->mVertices[i].y;
-        vertex.Position.z = mesh->mVertices[i].z;
-        
-        // Normals
-        if (mesh->HasNormals()) {
-            vertex.Normal.x = mesh->mNormals[i].x;
-            vertex.Normal.y = mesh->mNormals[i].y;
-            vertex.Normal.z = mesh->mNormals[i].z;
-        }
-        
-        // Texture coordinates
-        if (mesh->mTextureCoords[0]) {
-            vertex.TexCoords.x = mesh->mTextureCoords[0][i].x;
-            vertex.TexCoords.y = mesh->mTextureCoords[0][i].y;
-        } else {
-            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-        }
-        
-        vertices.push_back(vertex);
-    }
-    
-    // Process indices
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++)
-            indices.push_back(face.mIndices[j]);
+ClipLayer* AnimatedModelInstance::findLayer(int clipIndex) {
+    for (auto& layer : m_Layers) {
+        if (layer.clip == clipIndex) return &layer;
     }
-    
-    // Process bone weights
-    extractBoneWeightForVertices(vertices, mesh, scene);
+    return nullptr;
 }
 
-void AnimatedModel::setupMesh() {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-    
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-    
-    // Vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    
-    // Vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    
-    // Vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-    
-    // Bone IDs
-    glEnableVertexAttribArray(3);
-    glVertexAttribIPointer(3, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-    
-    // Bone weights
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-    
-    glBindVertexArray(0);
+void AnimatedModelInstance::fadeLayer(ClipLayer& layer, float targetWeight, float fadeDuration) {
+    // restart the fade from wherever the weight currently is
+    layer.startWeight = layer.weightAt(m_AnimationTime);
+    layer.targetWeight = targetWeight;
+    layer.fadeStart = m_AnimationTime;
+    layer.fadeDuration = fadeDuration;
 }
 
-void AnimatedModel::loadTexture(const std::string& filepath) {
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(false);
-    unsigned char* data = stbi_load(filepath.c_str(), &width, &height, &nrChannels, 0);
-    if (data) {
-        GLenum format;
-        if (nrChannels == 1) format = GL_RED;
-        else if (nrChannels == 3) format = GL_RGB;
-        else if (nrChannels == 4) format = GL_RGBA;
-        
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        std::cout << "Failed to load texture: " << filepath << std::endl;
+void AnimatedModelInstance::setAnimation(unsigned int animationIndex) {
+    if (animationIndex >= m_Asset->getClipCount()) {
+        std::cout << "ERROR:: Animation index " << animationIndex << " out of range" << std::endl;
+        return;
     }
-    stbi_image_free(data);
+    m_Layers.clear();
+    playClip(animationIndex);
 }
 
-void AnimatedModel::render() {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+void AnimatedModelInstance::playClip(unsigned int clipIndex, float weight, float fadeDuration, float timeOffset) {
+    if (clipIndex >= m_Asset->getClipCount()) {
+        std::cout << "ERROR:: Clip index " << clipIndex << " out of range" << std::endl;
+        return;
+    }
     
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    ClipLayer* layer = findLayer((int)clipIndex);
+    if (!layer) {
+        // page the keys in now rather than on the first sample
+        m_Asset->acquireClip(clipIndex);
+        ClipLayer newLayer;
+        newLayer.clip = (int)clipIndex;
+        newLayer.startWeight = 0.0f;
+        newLayer.targetWeight = 0.0f;
+        newLayer.fadeStart = m_AnimationTime;
+        newLayer.fadeDuration = 0.0f;
+        m_Layers.push_back(newLayer);
+        layer = &m_Layers.back();
+    }
+    layer->timeOffset = timeOffset;
+    fadeLayer(*layer, weight, fadeDuration);
 }
 
-void AnimatedModel::updateAnimation(float timeInSeconds) {
-    if (!m_CurrentAnimation) return;
-    
-    // Handle Mixamo FBX files where mTicksPerSecond might be 0
-    double ticksPerSecond = m_CurrentAnimation->mTicksPerSecond;
-    if (ticksPerSecond == 0.0) {
-        ticksPerSecond = 25.0; // Default to 25 FPS for Mixamo animations
-    }
-    
-    m_AnimationTime = fmod(timeInSeconds * ticksPerSecond, m_CurrentAnimation->mDuration);
-    calculateBoneTransform(m_scene->mRootNode, glm::mat4(1.0f), m_AnimationTime);
+void AnimatedModelInstance::stopClip(unsigned int clipIndex, float fadeDuration) {
+    ClipLayer* layer = findLayer((int)clipIndex);
+    if (!layer) return;
+    // the layer is removed by updateAnimation once it has faded out
+    fadeLayer(*layer, 0.0f, fadeDuration);
 }
 
-void AnimatedModel::calculateBoneTransform(const aiNode* node, glm::mat4 parentTransform, float animationTime) {
-    std::string nodeName = node->mName.data;
-    glm::mat4 nodeTransform = aiMatrix4x4ToGlm(node->mTransformation);
-    
-    const aiNodeAnim* nodeAnim = nullptr;
-    
-    // Find the animation node for this bone
-    if (m_CurrentAnimation) {
-        for (unsigned int i = 0; i < m_CurrentAnimation->mNumChannels; i++) {
-            if (std::string(m_CurrentAnimation->mChannels[i]->mNodeName.data) == nodeName) {
-                nodeAnim = m_CurrentAnimation->mChannels[i];
-                break;
-            }
-        }
+void AnimatedModelInstance::crossfadeTo(unsigned int clipIndex, float fadeDuration, float timeOffset) {
+    if (clipIndex >= m_Asset->getClipCount()) {
+        std::cout << "ERROR:: Clip index " << clipIndex << " out of range" << std::endl;
+        return;
     }
-    
-    if (nodeAnim) {
-        // Interpolate scaling and generate scaling transformation matrix
-        glm::vec3 scaling;
-        if (nodeAnim->mNumScalingKeys == 0) {
-            scaling = glm::vec3(1.0f);
-        } else if (nodeAnim->mNumScalingKeys == 1) {
-            scaling = aiVector3DToGlm(nodeAnim->mScalingKeys[0].mValue);
-        } else {
-            unsigned int scalingIndex = nodeAnim->mNumScalingKeys - 2; // Default to last pair
-            for (unsigned int i = 0; i < nodeAnim->mNumScalingKeys - 1; i++) {
-                if (animationTime < (float)nodeAnim->mScalingKeys[i + 1].mTime) {
-                    scalingIndex = i;
-                    break;
-                }
-            }
-            
-            float deltaTime = nodeAnim->mScalingKeys[scalingIndex + 1].mTime - nodeAnim->mScalingKeys[scalingIndex].mTime;
-            float factor = 0.0f;
-            if (deltaTime > 0.0001f) {
-                factor = (animationTime - (float)nodeAnim->mScalingKeys[scalingIndex].mTime) / deltaTime;
-                if (factor < 0.0f) factor = 0.0f;
-                if (factor > 1.0f) factor = 1.0f;
-            }
-            
-            glm::vec3 start = aiVector3DToGlm(nodeAnim->mScalingKeys[scalingIndex].mValue);
-            glm::vec3 end = aiVector3DToGlm(nodeAnim->mScalingKeys[scalingIndex + 1].mValue);
-            scaling = glm::mix(start, end, factor);
+    for (auto& layer : m_Layers) {
+        if (layer.clip != (int)clipIndex) {
+            fadeLayer(layer, 0.0f, fadeDuration);
         }
-        
-        // Interpolate rotation and generate rotation transformation matrix
-        glm::quat rotation;
-        if (nodeAnim->mNumRotationKeys == 0) {
-            rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); // Identity quaternion
-        } else if (nodeAnim->mNumRotationKeys == 1) {
-            rotation = aiQuaternionToGlm(nodeAnim->mRotationKeys[0].mValue);
+    }
+    playClip(clipIndex, 1.0f, fadeDuration, timeOffset);
+}
+
+void AnimatedModelInstance::updateAnimation(float timeInSeconds) {
+    m_AnimationTime = timeInSeconds;
+    if (m_Asset->m_Skeleton.size() == 0) return;
+    
+    // Drop layers that finished fading out
+    for (size_t i = 0; i < m_Layers.size();) {
+        const ClipLayer& layer = m_Layers[i];
+        if (layer.targetWeight <= 0.0f && layer.weightAt(timeInSeconds) <= 0.0f) {
+            m_Layers.erase(m_Layers.begin() + i);
         } else {
-            unsigned int rotationIndex = nodeAnim->mNumRotationKeys - 2; // Default to last pair
-            for (unsigned int i = 0; i < nodeAnim->mNumRotationKeys - 1; i++) {
-                if (animationTime < (float)nodeAnim->mRotationKeys[i + 1].mTime) {
-                    rotationIndex = i;
-                    break;
-                }
-            }
-            
-            float deltaTime = nodeAnim->mRotationKeys[rotationIndex + 1].mTime - nodeAnim->mRotationKeys[rotationIndex].mTime;
-            float factor = 0.0f;
-            if (deltaTime > 0.0001f) {
-                factor = (animationTime - (float)nodeAnim->mRotationKeys[rotationIndex].mTime) / deltaTime;
-                if (factor < 0.0f) factor = 0.0f;
-                if (factor > 1.0f) factor = 1.0f;
-            }
-            
-            glm::quat start = aiQuaternionToGlm(nodeAnim->mRotationKeys[rotationIndex].mValue);
-            glm::quat end = aiQuaternionToGlm(nodeAnim->mRotationKeys[rotationIndex + 1].mValue);
-            rotation = glm::slerp(start, end, factor);
+            i++;
         }
-        
-        // Interpolate translation and generate translation transformation matrix
-        glm::vec3 translation;
-        if (nodeAnim->mNumPositionKeys == 0) {
-            translation = glm::vec3(0.0f);
-        } else if (nodeAnim->mNumPositionKeys == 1) {
-            translation = aiVector3DToGlm(nodeAnim->mPositionKeys[0].mValue);
+    }
+    
+    // Collect what this frame would sample; if it matches the last evaluation
+    // the pose and palette are still valid
+    m_Samples.clear();
+    for (const auto& layer : m_Layers) {
+        float weight = layer.weightAt(timeInSeconds);
+        if (weight <= 0.0f) continue;
+        float duration = m_Asset->getClipDuration(layer.clip);
+        float clipTime = timeInSeconds + layer.timeOffset;
+        if (duration > 0.0f) {
+            clipTime = fmod(clipTime, duration);
+            if (clipTime < 0.0f) clipTime += duration;
         } else {
-            unsigned int positionIndex = nodeAnim->mNumPositionKeys - 2; // Default to last pair
-            for (unsigned int i = 0; i < nodeAnim->mNumPositionKeys - 1; i++) {
-                if (animationTime < (float)nodeAnim->mPositionKeys[i + 1].mTime) {
-                    positionIndex = i;
-                    break;
-                }
-            }
-            
-            float deltaTime = nodeAnim->mPositionKeys[positionIndex + 1].mTime - nodeAnim->mPositionKeys[positionIndex].mTime;
-            float factor = 0.0f;
-            if (deltaTime > 0.0001f) {
-                factor = (animationTime - (float)nodeAnim->mPositionKeys[positionIndex].mTime) / deltaTime;
-                if (factor < 0.0f) factor = 0.0f;
-                if (factor > 1.0f) factor = 1.0f;
-            }
-            
-            glm::vec3 start = aiVector3DToGlm(nodeAnim->mPositionKeys[positionIndex].mValue);
-            glm::vec3 end = aiVector3DToGlm(nodeAnim->mPositionKeys[positionIndex + 1].mValue);
-            translation = glm::mix(start, end, factor);
+            clipTime = 0.0f;
         }
-        
-        // Combine transformations
-        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), translation);
-        glm::mat4 rotationMatrix = glm::mat4_cast(rotation);
-        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), scaling);
-        
-        nodeTransform = translationMatrix * rotationMatrix * scaleMatrix;
+        m_Samples.push_back({ layer.clip, clipTime, weight });
     }
     
-    // Apply additional rotation if specified (for cinematic control)
-    auto additionalRotIt = m_AdditionalBoneRotations.find(nodeName);
-    if (additionalRotIt != m_AdditionalBoneRotations.end()) {
-        // Extract translation (last column)
-        glm::vec3 translation = glm::vec3(nodeTransform[3]);
-        
-        // Extract scale (length of first 3 columns)
-        glm::vec3 scale = glm::vec3(
-            glm::length(glm::vec3(nodeTransform[0])),
-            glm::length(glm::vec3(nodeTransform[1])),
-            glm::length(glm::vec3(nodeTransform[2]))
-        );
-        
-        // Extract rotation (normalize columns to remove scale)
-        glm::mat3 rotMat = glm::mat3(
-            glm::normalize(glm::vec3(nodeTransform[0])),
-            glm::normalize(glm::vec3(nodeTransform[1])),
-            glm::normalize(glm::vec3(nodeTransform[2]))
-        );
-        glm::quat currentRotation = glm::quat_cast(rotMat);
-        
-        // Combine rotations: additional rotation applied after animation rotation
-        // This means: finalRotation = additionalRotation * animationRotation
-        glm::quat combinedRotation = additionalRotIt->second * currentRotation;
-        
-        // Reconstruct transform with combined rotation
-        glm::mat4 combinedRotMatrix = glm::mat4_cast(combinedRotation);
-        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), scale);
-        glm::mat4 transMatrix = glm::translate(glm::mat4(1.0f), translation);
-        
-        nodeTransform = transMatrix * combinedRotMatrix * scaleMatrix;
+    if (m_HasEvaluated && m_Samples == m_LastSamples && m_OverrideVersion == m_LastOverrideVersion && m_Lod == m_LastLod) {
+        m_Stats.skippedUpdates++;
+        return;
+    }
+    m_LastSamples = m_Samples;
+    m_LastOverrideVersion = m_OverrideVersion;
+    m_LastLod = m_Lod;
+    m_HasEvaluated = true;
+    
+    // Nodes collapsed by the LOD are neither sampled nor concatenated
+    const size_t nodeCount = m_Asset->m_Skeleton.lodNodeCount(m_Lod);
+    
+    // Sample every playing clip into its own pose buffer
+    if (m_LayerPoses.size() < m_Samples.size()) {
+        m_LayerPoses.resize(m_Samples.size());
+        m_LayerWeights.resize(m_Samples.size());
+    }
+    const size_t activeLayers = m_Samples.size();
+    for (size_t i = 0; i < activeLayers; i++) {
+        // Nodes without a track keep their bind pose
+        Pose& pose = m_LayerPoses[i];
+        pose.setToBindPose(m_Asset->m_Skeleton);
+        sampleAnimationClip(m_Asset->acquireClip(m_Samples[i].clip), m_Samples[i].clipTime, pose, nodeCount);
+        m_LayerWeights[i] = m_Samples[i].weight;
     }
     
-    glm::mat4 globalTransformation = parentTransform * nodeTransform;
-    
-    auto boneInfoMap = m_BoneInfoMap.find(nodeName);
-    if (boneInfoMap != m_BoneInfoMap.end()) {
-        int index = boneInfoMap->second.id;
-        glm::mat4 offset = boneInfoMap->second.offset;
-        m_FinalBoneMatrices[index] = globalTransformation * offset;
+    if (activeLayers == 0) {
+        m_Pose.setToBindPose(m_Asset->m_Skeleton);
+    } else if (activeLayers == 1) {
+        // a single clip fully defines the pose, whatever its weight
+        std::swap(m_Pose, m_LayerPoses[0]);
+    } else {
+        blendPoses(m_LayerPoses.data(), m_LayerWeights.data(), activeLayers, m_Pose, nodeCount);
     }
     
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        calculateBoneTransform(node->mChildren[i], globalTransformation, animationTime);
+    // Apply additional rotation if specified (for cinematic control)
+    // finalRotation = additionalRotation * animationRotation
+    for (size_t i = 0; i < m_OverrideNodes.size(); i++) {
+        glm::quat& rotation = m_Pose.rotations[m_OverrideNodes[i]];
+        rotation = m_OverrideRotations[i] * rotation;
     }
+    
+    evaluateSkeleton(m_Asset->m_Skeleton, m_Pose, m_GlobalTransforms, m_FinalBoneMatrices, m_Lod);
+    updateBounds();
+    m_PaletteVersion++;
+    m_Stats.evaluatedUpdates++;
 }
 
-glm::mat4 AnimatedModel::aiMatrix4x4ToGlm(const aiMatrix4x4& from) {
-    glm::mat4 to;
-    to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
-    to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
-    to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
-    to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
-    return to;
+void AnimatedModelInstance::decomposePalette(const std::vector<glm::mat4>& palette, Pose& result) {
+    result.resize(palette.size());
+    for (size_t i = 0; i < palette.size(); i++) {
+        // bone matrices are rotation times scale, no shear
+        const glm::mat4& m = palette[i];
+        glm::vec3 scale(glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2])));
+        glm::vec3 safeScale = glm::max(scale, glm::vec3(1e-12f));
+        result.translations[i] = glm::vec3(m[3]);
+        result.rotations[i] = glm::normalize(glm::quat_cast(
+            glm::mat3(glm::vec3(m[0]) / safeScale.x, glm::vec3(m[1]) / safeScale.y, glm::vec3(m[2]) / safeScale.z)));
+        result.scales[i] = scale;
+    }
 }
 
-glm::vec3 AnimatedModel::aiVector3DToGlm(const aiVector3D& vec) {
-    return glm::vec3(vec.x, vec.y, vec.z);
+void AnimatedModelInstance::blendPalettes(const Pose& from, const Pose& to, float t) {
+    size_t count = std::min(std::min(from.rotations.size(), to.rotations.size()), m_FinalBoneMatrices.size());
+    for (size_t i = 0; i < count; i++) {
+        // shortest arc, then nlerp; the rotation matrix of an unnormalized q
+        // scales its terms by 2 / |q|^2, which replaces the normalize
+        const glm::quat& a = from.rotations[i];
+        float toWeight = glm::dot(a, to.rotations[i]) < 0.0f ? -t : t;
+        glm::quat q = a * (1.0f - t) + to.rotations[i] * toWeight;
+        float s = 2.0f / glm::dot(q, q);
+        float xx = q.x * q.x * s, yy = q.y * q.y * s, zz = q.z * q.z * s;
+        float xy = q.x * q.y * s, xz = q.x * q.z * s, yz = q.y * q.z * s;
+        float wx = q.w * q.x * s, wy = q.w * q.y * s, wz = q.w * q.z * s;
+        glm::vec3 scale = glm::mix(from.scales[i], to.scales[i], t);
+        glm::mat4& m = m_FinalBoneMatrices[i];
+        m[0] = glm::vec4(1.0f - yy - zz, xy + wz, xz - wy, 0.0f) * scale.x;
+        m[1] = glm::vec4(xy - wz, 1.0f - xx - zz, yz + wx, 0.0f) * scale.y;
+        m[2] = glm::vec4(xz + wy, yz - wx, 1.0f - xx - yy, 0.0f) * scale.z;
+        m[3] = glm::vec4(glm::mix(from.translations[i], to.translations[i], t), 1.0f);
+    }
+    // the palette no longer matches the inputs of the last evaluation
+    m_HasEvaluated = false;
+    updateBounds();
+    m_PaletteVersion++;
 }
 
-glm::quat AnimatedModel::aiQuaternionToGlm(const aiQuaternion& pOrientation) {
-    return glm::quat(pOrientation.w, pOrientation.x, pOrientation.y, pOrientation.z);
+bool AnimatedModelInstance::shouldUploadPalette(unsigned int programId) {
+    auto uploaded = m_UploadedPaletteVersions.find(programId);
+    if (uploaded != m_UploadedPaletteVersions.end() && uploaded->second == m_PaletteVersion) {
+        m_Stats.skippedPaletteUploads++;
+        return false;
+    }
+    m_UploadedPaletteVersions[programId] = m_PaletteVersion;
+    m_Stats.paletteUploads++;
+    return true;
 }
 
-void AnimatedModel::setVertexBoneDataToDefault(Vertex& vertex) {
-    for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
-        vertex.m_BoneIDs[i] = -1;
-        vertex.m_Weights[i] = 0.0f;
+void AnimatedModelInstance::updateBounds() {
+    // One box transform per bone, no vertex is skinned
+    const std::vector<BoundingBox>& boneBounds = m_Asset->m_BoneBounds;
+    m_Bounds = m_Asset->m_UnskinnedBounds;
+    for (size_t bone = 0; bone < boneBounds.size(); bone++) {
+        if (boneBounds[bone].isEmpty()) continue;
+        m_Bounds.expand(boneBounds[bone].transformed(m_FinalBoneMatrices[bone]));
     }
 }
 
-void AnimatedModel::setVertexBoneData(Vertex& vertex, int boneID, float weight) {
-    for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
-        if (vertex.m_BoneIDs[i] < 0) {
-            vertex.m_Weights[i] = weight;
-            vertex.m_BoneIDs[i] = boneID;
-            break;
-        }
+bool AnimatedModelInstance::isVisible(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const {
+    BoundingBox bounds = m_Bounds;
+    if (bounds.isEmpty()) {
+        bounds.expand(m_Asset->getBoundsMin());
+        bounds.expand(m_Asset->getBoundsMax());
     }
+    return Frustum(projection * view * model).intersects(bounds);
 }
 
-void AnimatedModel::extractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const aiScene* scene) {
-    std::cout << "  Processing " << mesh->mNumBones << " bones for mesh" << std::endl;
-    
-    for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex) {
-        int boneID = -1;
-        std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
-        
-        if (m_BoneInfoMap.find(boneName) == m_BoneInfoMap.end()) {
-            // Check if bone ID would exceed MAX_BONES limit
-            if (m_BoneCounter >= 100) {
-                std::cout << "WARNING:: Bone ID " << m_BoneCounter << " exceeds MAX_BONES limit (100) for bone: " << boneName << std::endl;
-                continue; // Skip this bone
-            }
-            
-            BoneInfo newBoneInfo;
-            newBoneInfo.id = m_BoneCounter;
-            newBoneInfo.offset = aiMatrix4x4ToGlm(mesh->mBones[boneIndex]->mOffsetMatrix);
-            m_BoneInfoMap[boneName] = newBoneInfo;
-            boneID = m_BoneCounter;
-            m_BoneCounter++;
-            
-            // Debug: Print foot-related bones
-            if (boneName.find("Foot") != std::string::npos || 
-                boneName.find("Toe") != std::string::npos ||
-                boneName.find("foot") != std::string::npos ||
-                boneName.find("toe") != std::string::npos) {
-                std::cout << "    Found foot bone: " << boneName << " (ID: " << boneID << ")" << std::endl;
-            }
-        } else {
-            boneID = m_BoneInfoMap[boneName].id;
-        }
-        
-        if (boneID == -1 || boneID >= 100) {
-            std::cout << "ERROR:: Invalid bone ID for: " << boneName << std::endl;
-            continue;
-        }
-        
-        auto weights = mesh->mBones[boneIndex]->mWeights;
-        int numWeights = mesh->mBones[boneIndex]->mNumWeights;
-        
-        for (int weightIndex = 0; weightIndex < numWeights; ++weightIndex) {
-            int vertexId = weights[weightIndex].mVertexId;
-            float weight = weights[weightIndex].mWeight;
-            
-            if (vertexId >= (int)vertices.size()) {
-                std::cout << "ERROR:: Vertex ID " << vertexId << " out of range (max: " << vertices.size() << ")" << std::endl;
-                continue;
-            }
-            
-            setVertexBoneData(vertices[vertexId], boneID, weight);
-        }
-    }
-    
-    // Validate weights after processing all bones
-    int verticesWithZeroWeight = 0;
-    int verticesWithInvalidBoneID = 0;
-    for (size_t i = 0; i < vertices.size(); ++i) {
-        float totalWeight = 0.0f;
-        bool hasValidBone = false;
-        
-        for (int j = 0; j < MAX_BONE_INFLUENCE; ++j) {
-            if (vertices[i].m_BoneIDs[j] >= 0) {
-                if (vertices[i].m_BoneIDs[j] >= 100) {
-                    verticesWithInvalidBoneID++;
-                } else {
-                    hasValidBone = true;
-                }
-                totalWeight += vertices[i].m_Weights[j];
-            }
-        }
-        
-        if (!hasValidBone || totalWeight < 0.01f) {
-            verticesWithZeroWeight++;
-            // Debug: Print first few problematic vertices (likely foot vertices)
-            if (verticesWithZeroWeight <= 10) {
-                std::cout << "WARNING:: Vertex " << i << " has no valid bone weights (total: " << totalWeight << ")" << std::endl;
-            }
-        }
+unsigned int AnimatedModelInstance::selectLod(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
+    // Fraction of the viewport height the bounding sphere covers; LOD 0 down to
+    // a quarter of the screen, the last level below 5%
+    static const float kLodScreenSizes[SKELETON_LOD_COUNT - 1] = { 0.25f, 0.12f, 0.05f };
+    
+    glm::vec3 center = (m_Asset->getBoundsMin() + m_Asset->getBoundsMax()) * 0.5f;
+    float radius = glm::length(m_Asset->getBoundsMax() - m_Asset->getBoundsMin()) * 0.5f;
+    if (!m_Bounds.isEmpty()) {
+        center = m_Bounds.center();
+        radius = glm::length(m_Bounds.extent());
     }
-    
-    if (verticesWithZeroWeight > 0) {
-        std::cout << "WARNING:: " << verticesWithZeroWeight << " vertices have zero or invalid bone weights!" << std::endl;
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    glm::vec4 viewCenter = view * model * glm::vec4(center, 1.0f);
+    float distance = -viewCenter.z;
+    float worldRadius = radius * scale;
+    float screenSize = (distance > worldRadius) ? worldRadius * projection[1][1] / distance : 1.0f;
+    
+    unsigned int lod = 0;
+    while (lod < SKELETON_LOD_COUNT - 1 && screenSize < kLodScreenSizes[lod]) lod++;
+    setLod(lod);
+    return m_Lod;
+}
+
+void AnimatedModelInstance::setLod(unsigned int lod) {
+    m_Lod = std::min(lod, (unsigned int)SKELETON_LOD_COUNT - 1);
+}
+
+size_t AnimatedModelInstance::memoryUsage() const {
+    auto poseBytes = [](const Pose& pose) {
+        return pose.translations.capacity() * sizeof(glm::vec3) + pose.rotations.capacity() * sizeof(glm::quat)
+             + pose.scales.capacity() * sizeof(glm::vec3);
+    };
+    size_t bytes = sizeof(*this) + poseBytes(m_Pose);
+    for (const auto& pose : m_LayerPoses) {
+        bytes += poseBytes(pose);
     }
-    if (verticesWithInvalidBoneID > 0) {
-        std::cout << "ERROR:: " << verticesWithInvalidBoneID << " vertices have bone IDs >= 100!" << std::endl;
+    bytes += (m_FinalBoneMatrices.capacity() + m_GlobalTransforms.capacity()) * sizeof(glm::mat4);
+    bytes += m_Layers.capacity() * sizeof(ClipLayer) + m_LayerWeights.capacity() * sizeof(float);
+    bytes += (m_Samples.capacity() + m_LastSamples.capacity()) * sizeof(LayerSample);
+    bytes += m_OverrideNodes.capacity() * sizeof(int) + m_OverrideRotations.capacity() * sizeof(glm::quat);
+    return bytes;
+}
+
+BoneHandle AnimatedModelInstance::findBone(const std::string& boneName) const {
+    BoneHandle handle;
+    handle.node = m_Asset->m_Skeleton.findNode(boneName);
+    return handle;
+}
+
+void AnimatedModelInstance::setBoneAdditionalRotation(BoneHandle bone, const glm::quat& additionalRotation) {
+    if (!bone.isValid() || bone.node >= (int)m_Pose.rotations.size()) return;
+    auto existing = std::find(m_OverrideNodes.begin(), m_OverrideNodes.end(), bone.node);
+    if (existing == m_OverrideNodes.end()) {
+        m_OverrideNodes.push_back(bone.node);
+        m_OverrideRotations.push_back(additionalRotation);
+    } else {
+        glm::quat& rotation = m_OverrideRotations[existing - m_OverrideNodes.begin()];
+        if (rotation == additionalRotation) return;
+        rotation = additionalRotation;
     }
+    m_OverrideVersion++;
 }
 
-void AnimatedModel::setBoneAdditionalRotation(const std::string& boneName, const glm::quat& additionalRotation) {
-    m_AdditionalBoneRotations[boneName] = additionalRotation;
+void AnimatedModelInstance::clearBoneAdditionalRotation(BoneHandle bone) {
+    auto existing = std::find(m_OverrideNodes.begin(), m_OverrideNodes.end(), bone.node);
+    if (!bone.isValid() || existing == m_OverrideNodes.end()) return;
+    // order does not matter, swap with the last one
+    size_t i = existing - m_OverrideNodes.begin();
+    m_OverrideNodes[i] = m_OverrideNodes.back();
+    m_OverrideRotations[i] = m_OverrideRotations.back();
+    m_OverrideNodes.pop_back();
+    m_OverrideRotations.pop_back();
+    m_OverrideVersion++;
 }
 
-void AnimatedModel::clearBoneAdditionalRotation(const std::string& boneName) {
-    m_AdditionalBoneRotations.erase(boneName);
+void AnimatedModelInstance::setBoneAdditionalRotation(const std::string& boneName, const glm::quat& additionalRotation) {
+    setBoneAdditionalRotation(findBone(boneName), additionalRotation);
 }
 
-void AnimatedModel::clearAllBoneAdditionalRotations() {
-    m_AdditionalBoneRotations.clear();
+void AnimatedModelInstance::clearBoneAdditionalRotation(const std::string& boneName) {
+    clearBoneAdditionalRotation(findBone(boneName));
 }
+
+void AnimatedModelInstance::clearAllBoneAdditionalRotations() {
+    if (m_OverrideNodes.empty()) return;
+    m_OverrideNodes.clear();
+    m_OverrideRotations.clear();
+    m_OverrideVersion++;
+}
\ No newline at end of file
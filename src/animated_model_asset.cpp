@@ -0,0 +1,1014 @@
+#include "header/animated_model_asset.h"
+#include "header/stb_image.h"
+#include <glm/gtc/packing.hpp>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+namespace {
+
+// Bump the first entry when the mesh cache payload changes; the compile-time
+// import settings are part of the cache key as well
+const uint32_t kMeshCacheLayout[] = { 1, MAX_BONE_INFLUENCE, MAX_PALETTE_BONES, (uint32_t)sizeof(Vertex),
+                                      (uint32_t)(MIN_BONE_WEIGHT * 1e6f) };
+// Smallest mesh cache records: name length and six words per submesh, the
+// array count per palette, name length, id and offset matrix per bone
+const size_t kMinSubmeshSize = 4 + 6 * 4;
+const size_t kMinPaletteSize = 4;
+const size_t kMinBoneSize = 4 + 4 + sizeof(glm::mat4);
+
+} // namespace
+
+AnimatedModelAsset::AnimatedModelAsset(const std::string& path, float clipErrorBound, bool quantizePositions,
+                                       int boneInfluences)
+    : m_ClipErrorBound(clipErrorBound), m_QuantizePositions(quantizePositions), m_BoneInfluences(boneInfluences) {
+    if (m_BoneInfluences != 1 && m_BoneInfluences != 2 && m_BoneInfluences != 4 && m_BoneInfluences != 8) {
+        std::cout << "WARNING:: Unsupported bone influence count " << m_BoneInfluences << ", using 4" << std::endl;
+        m_BoneInfluences = 4;
+    }
+    loadModel(path);
+}
+
+AnimatedModelAsset::~AnimatedModelAsset() {
+    // nothing was uploaded if the load failed
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    if (VBO) glDeleteBuffers(1, &VBO);
+    if (EBO) glDeleteBuffers(1, &EBO);
+    if (texture) glDeleteTextures(1, &texture);
+}
+
+void AnimatedModelAsset::loadModel(const std::string& path) {
+    // Check if file exists
+    std::ifstream fileCheck(path);
+    if (!fileCheck.good()) {
+        std::cout << "ERROR::ASSIMP:: File not found: " << path << std::endl;
+        return;
+    }
+    fileCheck.close();
+    
+    // Import flags optimized for Mixamo FBX files
+    unsigned int importFlags = aiProcess_Triangulate 
+                             | aiProcess_GenSmoothNormals 
+                             | aiProcess_FlipUVs 
+                             | aiProcess_CalcTangentSpace
+                             | aiProcess_LimitBoneWeights;  // Limit bone weights for better performance
+    
+    // A mesh cache built from the same file contents and settings replaces the
+    // whole import: mesh, palettes and skeleton come out of the mapped file
+    const std::string cachePath = path + ".meshcache";
+    uint64_t options = hashBytes(kMeshCacheLayout, sizeof(kMeshCacheLayout));
+    options = hashBytes(&importFlags, sizeof(importFlags), options);
+    options = hashBytes(&m_BoneInfluences, sizeof(m_BoneInfluences), options);
+    options = hashBytes(&m_QuantizePositions, sizeof(m_QuantizePositions), options);
+    uint64_t cacheKey = 0;
+    bool haveKey = meshCacheKey(path, options, cacheKey);
+    
+    // An up-to-date clip library replaces the FBX animations, they are then not
+    // even imported and only the clip table is read. It shares the mesh cache
+    // key: touching the file without changing it keeps the library, changing
+    // the import settings rebuilds it along with the mesh cache.
+    const std::string libraryPath = path + ".clips";
+    m_ClipLibrary.reset(new ClipLibrary(m_Clips));
+    bool libraryCurrent = haveKey && m_ClipLibrary->open(libraryPath, cacheKey, m_ClipErrorBound);
+    
+    bool meshCached = haveKey && loadMeshCache(cachePath, cacheKey);
+    
+    // The importer only lives for the duration of the load: mesh, skeleton and
+    // baked clips are copied out, so the aiScene is released on return
+    Assimp::Importer importer;
+    const aiScene* scene = nullptr;
+    if (meshCached) {
+        std::cout << "Loaded mesh cache: " << cachePath << " (FBX import skipped)" << std::endl;
+    } else {
+        scene = importScene(importer, path, importFlags, !libraryCurrent);
+        if (!scene) return;
+        
+        processNode(scene->mRootNode, scene);
+        
+        // how many influences the vertices kept, index 0 counts vertices without bones
+        std::vector<size_t> influenceHistogram(m_BoneInfluences + 1, 0);
+        for (const auto& vertex : vertices) {
+            int count = 0;
+            while (count < m_BoneInfluences && vertex.m_BoneIDs[count] >= 0) count++;
+            influenceHistogram[count]++;
+        }
+        std::cout << "  - Bone influences (max " << m_BoneInfluences << "):";
+        for (size_t i = 0; i < influenceHistogram.size(); i++) {
+            if (influenceHistogram[i] > 0) std::cout << " " << i << ": " << influenceHistogram[i];
+        }
+        std::cout << " vertices" << std::endl;
+        
+        buildPalettes();
+        std::vector<uint8_t> packedVertices;
+        packVertices(packedVertices);
+        uploadMesh(packedVertices.data());
+        
+        // Flatten the hierarchy once, bones are known after processing the meshes
+        m_Skeleton.build(scene->mRootNode, m_BoneInfoMap);
+        
+        if (!haveKey || !saveMeshCache(cachePath, cacheKey, packedVertices)) {
+            std::cout << "WARNING::MESH_CACHE: No mesh cache, the next start imports the FBX again" << std::endl;
+        }
+    }
+    
+    if (libraryCurrent && m_ClipLibrary->nodeCount() != m_Skeleton.size()) {
+        std::cout << "WARNING::CLIP_LIBRARY: " << libraryPath << " was built for another skeleton, rebuilding it" << std::endl;
+        m_ClipLibrary.reset(new ClipLibrary(m_Clips));
+        libraryCurrent = false;
+        importClips(path);
+    } else if (!libraryCurrent) {
+        // a cached mesh means the FBX was not imported, read only its animations
+        if (scene) {
+            bakeClips(scene);
+        } else {
+            importClips(path);
+        }
+    }
+    if (!libraryCurrent) {
+        // keep only the clip table resident, clips are paged in when played
+        if (!haveKey || !ClipLibrary::write(libraryPath, m_Clips, cacheKey, m_ClipErrorBound, m_Skeleton.size()) ||
+            !m_ClipLibrary->open(libraryPath, cacheKey, m_ClipErrorBound)) {
+            std::cout << "WARNING::CLIP_LIBRARY: No clip library, keeping all clips resident" << std::endl;
+            m_ClipLibrary.reset();
+        }
+    }
+    if (m_ClipLibrary) {
+        std::cout << "  - Clip library: " << libraryPath << ", " << m_ClipLibrary->clipCount() << " clips, "
+                  << m_ClipLibrary->fileSize() / 1024.0f << " KB mapped"
+                  << (libraryCurrent ? ", FBX animations skipped" : "") << std::endl;
+    }
+    
+    if (!m_Clips.empty()) {
+        const AnimationClip& clip = acquireClip(0);
+        std::cout << "  - Animation name: " << clip.name << std::endl;
+        std::cout << "  - Animation duration: " << clip.duration << " s" << std::endl;
+        std::cout << "  - Animation baked at: " << clip.sampleRate << " Hz, " << clip.frameCount << " frames" << std::endl;
+        std::cout << "  - Animation tracks: " << clip.trackCount() << std::endl;
+    } else {
+        std::cout << "WARNING:: No animations found in FBX file!" << std::endl;
+    }
+    
+    std::cout << "Model processed: " << vertices.size() << " vertices, " << indices.size() << " indices, "
+              << m_Submeshes.size() << " submeshes" << std::endl;
+    std::cout << "Bones loaded: " << m_BoneCounter << std::endl;
+}
+
+const aiScene* AnimatedModelAsset::importScene(Assimp::Importer& importer, const std::string& path,
+                                               unsigned int importFlags, bool readAnimations) {
+    // Configure FBX importer settings for Mixamo files
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_ANIMATIONS, readAnimations);
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_WEIGHTS, true);
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_PRESERVE_PIVOTS, false);  // Mixamo doesn't need this
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_STRICT_MODE, false);  // Allow different FBX versions
+    // keep up to 8 weights, limitBoneInfluences() prunes them to the configured count
+    importer.SetPropertyInteger(AI_CONFIG_PP_LBW_MAX_WEIGHTS, MAX_BONE_INFLUENCE);
+    
+    std::cout << "Loading FBX file: " << path << std::endl;
+    const aiScene* scene = importer.ReadFile(path, importFlags);
+    
+    if (!scene) {
+        std::string errorString = importer.GetErrorString();
+        if (errorString.empty()) {
+            errorString = "Unknown error - file may be corrupted or unsupported format";
+        }
+        std::cout << "ERROR::ASSIMP:: Failed to load file: " << path << std::endl;
+        std::cout << "ERROR::ASSIMP:: " << errorString << std::endl;
+        return nullptr;
+    }
+    
+    if (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) {
+        std::cout << "WARNING::ASSIMP:: Scene is incomplete: " << importer.GetErrorString() << std::endl;
+    }
+    
+    if (!scene->mRootNode) {
+        std::cout << "ERROR::ASSIMP:: Scene has no root node" << std::endl;
+        return nullptr;
+    }
+    
+    std::cout << "FBX file loaded successfully!" << std::endl;
+    std::cout << "  - Meshes: " << scene->mNumMeshes << std::endl;
+    std::cout << "  - Animations: " << scene->mNumAnimations << std::endl;
+    std::cout << "  - Materials: " << scene->mNumMaterials << std::endl;
+    return scene;
+}
+
+void AnimatedModelAsset::processNode(aiNode* node, const aiScene* scene) {
+    // Process each mesh located at the current node
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        processMesh(mesh, scene);
+    }
+    
+    // Recursively process each of the children nodes
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        processNode(node->mChildren[i], scene);
+    }
+}
+
+void AnimatedModelAsset::processMesh(aiMesh* mesh, const aiScene* scene) {
+    // Every mesh is appended to the shared buffers, indices stay mesh-local and
+    // are drawn with the submesh base vertex
+    Submesh submesh;
+    submesh.name = mesh->mName.C_Str();
+    submesh.baseVertex = (unsigned int)vertices.size();
+    submesh.vertexCount = mesh->mNumVertices;
+    submesh.firstIndex = (unsigned int)indices.size();
+    submesh.materialIndex = mesh->mMaterialIndex;
+    
+    // Process vertices
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+        Vertex vertex;
+        setVertexBoneDataToDefault(vertex);
+        
+        // Position
+        vertex.Position.x = mesh->mVertices[i].x;
+        vertex.Position.y = mesh->mVertices[i].y;
+        vertex.Position.z = mesh->mVertices[i].z;
+        
+        // Normals
+        if (mesh->HasNormals()) {
+            vertex.Normal.x = mesh->mNormals[i].x;
+            vertex.Normal.y = mesh->mNormals[i].y;
+            vertex.Normal.z = mesh->mNormals[i].z;
+        }
+        
+        // Texture coordinates
+        if (mesh->mTextureCoords[0]) {
+            vertex.TexCoords.x = mesh->mTextureCoords[0][i].x;
+            vertex.TexCoords.y = mesh->mTextureCoords[0][i].y;
+        } else {
+            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+        }
+        
+        vertices.push_back(vertex);
+    }
+    
+    // Process indices
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        aiFace face = mesh->mFaces[i];
+        for (unsigned int j = 0; j < face.mNumIndices; j++)
+            indices.push_back(face.mIndices[j]);
+    }
+    submesh.indexCount = (unsigned int)indices.size() - submesh.firstIndex;
+    m_Submeshes.push_back(submesh);
+    
+    // Process bone weights
+    extractBoneWeightForVertices(vertices, mesh, scene, submesh.baseVertex);
+    for (size_t i = submesh.baseVertex; i < vertices.size(); i++) {
+        limitBoneInfluences(vertices[i]);
+    }
+}
+
+namespace {
+
+// Octahedral normal encoding: project on the octahedron, fold the lower half over
+glm::vec2 encodeOctahedral(glm::vec3 n) {
+    n /= (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f) {
+        glm::vec2 signs(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+        e = (glm::vec2(1.0f) - glm::abs(glm::vec2(e.y, e.x))) * signs;
+    }
+    return e;
+}
+
+void packAttributes(const Vertex& vertex, PackedVertexAttributes& packed) {
+    glm::vec3 normal = vertex.Normal;
+    if (glm::dot(normal, normal) < 1e-12f) normal = glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec2 octahedral = encodeOctahedral(glm::normalize(normal));
+    for (int i = 0; i < 2; i++) {
+        packed.normal[i] = (int16_t)std::lround(glm::clamp(octahedral[i], -1.0f, 1.0f) * 32767.0f);
+        packed.texCoords[i] = glm::packHalf1x16(vertex.TexCoords[i]);
+    }
+}
+
+void packPosition(const glm::vec3& position, const glm::vec3&, const glm::vec3&, FloatPosition& packed) {
+    for (int c = 0; c < 3; c++) packed.value[c] = position[c];
+}
+
+void packPosition(const glm::vec3& position, const glm::vec3& offset, const glm::vec3& scale, QuantizedPosition& packed) {
+    glm::vec3 unit = (position - offset) / scale;
+    for (int c = 0; c < 3; c++) {
+        packed.value[c] = (uint16_t)std::lround(glm::clamp(unit[c], 0.0f, 1.0f) * 65535.0f);
+    }
+    packed.value[3] = 0;
+}
+
+// localBoneIds maps skeleton bone ids to indices in the vertex's submesh
+// palette, its last entry is the palette's identity bone. Influences are
+// already sorted and normalized by limitBoneInfluences().
+template <int Influences>
+void packInfluences(const Vertex& vertex, const std::vector<int>& localBoneIds, PackedBoneInfluences<Influences>& packed) {
+    for (int i = 0; i < Influences; i++) {
+        packed.boneIDs[i] = 0;
+        packed.weights[i] = 0;
+    }
+    if (vertex.m_BoneIDs[0] < 0) {
+        packed.boneIDs[0] = (uint8_t)localBoneIds.back();
+        packed.weights[0] = 255;
+        return;
+    }
+    // Quantize the weights so they still sum to exactly 255, the rounding
+    // remainder goes to the largest influence, which is the first
+    int quantizedTotal = 0;
+    for (int i = 0; i < Influences && vertex.m_BoneIDs[i] >= 0; i++) {
+        packed.boneIDs[i] = (uint8_t)localBoneIds[vertex.m_BoneIDs[i]];
+        packed.weights[i] = (uint8_t)std::lround(vertex.m_Weights[i] * 255.0f);
+        quantizedTotal += packed.weights[i];
+    }
+    packed.weights[0] = (uint8_t)(packed.weights[0] + 255 - quantizedTotal);
+}
+
+void packInfluences(const Vertex& vertex, const std::vector<int>& localBoneIds, PackedBoneInfluences<1>& packed) {
+    packed.boneIDs[0] = (uint8_t)(vertex.m_BoneIDs[0] >= 0 ? localBoneIds[vertex.m_BoneIDs[0]] : localBoneIds.back());
+    packed.padding[0] = packed.padding[1] = packed.padding[2] = 0;
+}
+
+} // namespace
+
+void AnimatedModelAsset::buildPalettes() {
+    std::vector<Vertex> splitVertices;
+    std::vector<unsigned int> splitIndices;
+    std::vector<Submesh> splitSubmeshes;
+    std::map<std::vector<unsigned int>, unsigned int> paletteLookup;
+    m_Palettes.clear();
+    
+    // bone m_BoneCounter stands for the identity entry of vertices without bones
+    std::vector<char> inChunk(m_BoneCounter + 1, 0);
+    std::vector<unsigned int> chunkBones;
+    std::vector<int> vertexRemap;
+    
+    // Finishes the index range [begin, end) of a source submesh as a new submesh
+    // whose palette is chunkBones
+    auto emitChunk = [&](const Submesh& source, unsigned int begin, unsigned int end, bool wholeSubmesh, int part) {
+        Submesh submesh = source;
+        submesh.baseVertex = (unsigned int)splitVertices.size();
+        submesh.firstIndex = (unsigned int)splitIndices.size();
+        submesh.indexCount = end - begin;
+        if (wholeSubmesh) {
+            splitVertices.insert(splitVertices.end(), vertices.begin() + source.baseVertex,
+                                 vertices.begin() + source.baseVertex + source.vertexCount);
+            splitIndices.insert(splitIndices.end(), indices.begin() + source.firstIndex + begin,
+                                indices.begin() + source.firstIndex + end);
+        } else {
+            // a split part only gets the vertices its triangles use
+            submesh.name += "#" + std::to_string(part);
+            vertexRemap.assign(source.vertexCount, -1);
+            for (unsigned int i = begin; i < end; i++) {
+                unsigned int local = indices[source.firstIndex + i];
+                if (vertexRemap[local] < 0) {
+                    vertexRemap[local] = (int)(splitVertices.size() - submesh.baseVertex);
+                    splitVertices.push_back(vertices[source.baseVertex + local]);
+                }
+                splitIndices.push_back((unsigned int)vertexRemap[local]);
+            }
+        }
+        submesh.vertexCount = (unsigned int)splitVertices.size() - submesh.baseVertex;
+        
+        std::vector<unsigned int> palette = chunkBones;
+        for (unsigned int& bone : palette) {
+            if (bone == (unsigned int)m_BoneCounter) bone = PALETTE_IDENTITY_BONE;
+        }
+        std::sort(palette.begin(), palette.end());
+        auto found = paletteLookup.find(palette);
+        if (found == paletteLookup.end()) {
+            found = paletteLookup.emplace(palette, (unsigned int)m_Palettes.size()).first;
+            m_Palettes.push_back(palette);
+        }
+        submesh.palette = found->second;
+        splitSubmeshes.push_back(submesh);
+        
+        for (unsigned int bone : chunkBones) inChunk[bone] = 0;
+        chunkBones.clear();
+    };
+    
+    for (const Submesh& source : m_Submeshes) {
+        // Triangles join the current part while its palette still fits
+        unsigned int chunkBegin = 0;
+        int part = 0;
+        unsigned int triangleBones[3 * MAX_BONE_INFLUENCE];
+        // bones of triangle t that the current part does not have yet
+        auto collectNewBones = [&](unsigned int t) {
+            int newBones = 0;
+            for (int c = 0; c < 3; c++) {
+                const Vertex& vertex = vertices[source.baseVertex + indices[source.firstIndex + t + c]];
+                for (int i = 0; i < m_BoneInfluences; i++) {
+                    int bone = vertex.m_BoneIDs[i];
+                    if (bone < 0 && i == 0) bone = m_BoneCounter;
+                    if (bone < 0 || inChunk[bone]) continue;
+                    if (std::find(triangleBones, triangleBones + newBones, (unsigned int)bone) == triangleBones + newBones) {
+                        triangleBones[newBones++] = (unsigned int)bone;
+                    }
+                }
+            }
+            return newBones;
+        };
+        for (unsigned int t = 0; t + 2 < source.indexCount; t += 3) {
+            int newBones = collectNewBones(t);
+            if (chunkBones.size() + newBones > MAX_PALETTE_BONES && t > chunkBegin) {
+                emitChunk(source, chunkBegin, t, false, part++);
+                chunkBegin = t;
+                newBones = collectNewBones(t);
+            }
+            for (int i = 0; i < newBones; i++) {
+                inChunk[triangleBones[i]] = 1;
+                chunkBones.push_back(triangleBones[i]);
+            }
+        }
+        emitChunk(source, chunkBegin, source.indexCount, part == 0, part);
+    }
+    
+    if (splitSubmeshes.size() != m_Submeshes.size()) {
+        std::cout << "  - Split " << m_Submeshes.size() << " meshes into " << splitSubmeshes.size()
+                  << " submeshes to fit " << MAX_PALETTE_BONES << " bones per palette" << std::endl;
+    }
+    vertices.swap(splitVertices);
+    indices.swap(splitIndices);
+    m_Submeshes.swap(splitSubmeshes);
+    
+    std::cout << "  - Bone palettes: " << m_Palettes.size() << ", largest " << maxPaletteSize()
+              << " of " << m_BoneCounter << " bones" << std::endl;
+}
+
+unsigned int AnimatedModelAsset::maxPaletteSize() const {
+    size_t largest = 0;
+    for (const auto& palette : m_Palettes) largest = std::max(largest, palette.size());
+    return (unsigned int)largest;
+}
+
+template <int Influences>
+void AnimatedModelAsset::packVertices(const std::vector<std::vector<int>>& localBoneIds,
+                                      const std::vector<unsigned int>& vertexPalette, std::vector<uint8_t>& packed) {
+    if (m_QuantizePositions) {
+        packVertices<QuantizedPosition, Influences>(localBoneIds, vertexPalette, packed);
+    } else {
+        packVertices<FloatPosition, Influences>(localBoneIds, vertexPalette, packed);
+    }
+}
+
+template <typename Position, int Influences>
+void AnimatedModelAsset::packVertices(const std::vector<std::vector<int>>& localBoneIds,
+                                      const std::vector<unsigned int>& vertexPalette, std::vector<uint8_t>& packed) {
+    typedef PackedVertex<Position, Influences> GpuVertex;
+    packed.resize(vertices.size() * sizeof(GpuVertex));
+    GpuVertex* gpuVertices = (GpuVertex*)packed.data();
+    for (size_t i = 0; i < vertices.size(); i++) {
+        packPosition(vertices[i].Position, m_PositionOffset, m_PositionScale, gpuVertices[i].position);
+        packAttributes(vertices[i], gpuVertices[i].attributes);
+        packInfluences(vertices[i], localBoneIds[vertexPalette[i]], gpuVertices[i].influences);
+    }
+    m_VertexStride = sizeof(GpuVertex);
+    m_TexCoordOffset = offsetof(GpuVertex, attributes) + offsetof(PackedVertexAttributes, texCoords);
+    m_NormalOffset = offsetof(GpuVertex, attributes) + offsetof(PackedVertexAttributes, normal);
+    m_InfluencesOffset = offsetof(GpuVertex, influences);
+}
+
+void AnimatedModelAsset::setVertexAttributes() const {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLsizei stride = (GLsizei)m_VertexStride;
+    
+    // Positions lead the packed vertex, either kept as floats or stored as unorm16
+    // inside the mesh bounds
+    glEnableVertexAttribArray(0);
+    if (m_QuantizePositions) {
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)0);
+    } else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    }
+    
+    // Vertex normals (octahedral)
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)m_NormalOffset);
+    
+    // Vertex texture coords
+    setTexCoordAttribute(2);
+    
+    // Bone IDs and weights, 8 influences take two attributes each; a single
+    // influence has no weight
+    const int components = m_BoneInfluences < 4 ? m_BoneInfluences : 4;
+    size_t idsOffset = m_InfluencesOffset;
+    size_t weightsOffset = idsOffset + m_BoneInfluences;
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, components, GL_UNSIGNED_BYTE, stride, (void*)idsOffset);
+    if (m_BoneInfluences > 1) {
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, components, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)weightsOffset);
+    }
+    if (m_BoneInfluences > 4) {
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, stride, (void*)(idsOffset + 4));
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(weightsOffset + 4));
+    }
+}
+
+void AnimatedModelAsset::setupMesh() {
+    std::vector<uint8_t> packed;
+    packVertices(packed);
+    uploadMesh(packed.data());
+}
+
+void AnimatedModelAsset::packVertices(std::vector<uint8_t>& packed) {
+    packed.clear();
+    if (vertices.empty()) return;
+    
+    // skeleton bone id -> palette index, for the palette of every vertex; the
+    // extra last entry is the palette's identity bone
+    std::vector<std::vector<int>> localBoneIds(m_Palettes.size(), std::vector<int>(m_BoneCounter + 1, 0));
+    for (size_t p = 0; p < m_Palettes.size(); p++) {
+        for (size_t i = 0; i < m_Palettes[p].size(); i++) {
+            unsigned int bone = m_Palettes[p][i];
+            localBoneIds[p][bone == PALETTE_IDENTITY_BONE ? m_BoneCounter : bone] = (int)i;
+        }
+    }
+    std::vector<unsigned int> vertexPalette(vertices.size(), 0);
+    for (const Submesh& submesh : m_Submeshes) {
+        std::fill(vertexPalette.begin() + submesh.baseVertex,
+                  vertexPalette.begin() + submesh.baseVertex + submesh.vertexCount, submesh.palette);
+    }
+    
+    // A skinned vertex is a weighted average of its bones' transforms of it, so
+    // it stays inside the union of its bones' boxes moved by their matrices
+    m_BoneBounds.assign(m_BoneCounter, BoundingBox());
+    m_UnskinnedBounds.reset();
+    m_BoundsMin = m_BoundsMax = vertices[0].Position;
+    for (const auto& vertex : vertices) {
+        m_BoundsMin = glm::min(m_BoundsMin, vertex.Position);
+        m_BoundsMax = glm::max(m_BoundsMax, vertex.Position);
+        if (vertex.m_BoneIDs[0] < 0) {
+            m_UnskinnedBounds.expand(vertex.Position);
+        }
+        for (int i = 0; i < MAX_BONE_INFLUENCE && vertex.m_BoneIDs[i] >= 0; i++) {
+            m_BoneBounds[vertex.m_BoneIDs[i]].expand(vertex.Position);
+        }
+    }
+    if (m_QuantizePositions) {
+        m_PositionOffset = m_BoundsMin;
+        m_PositionScale = glm::max(m_BoundsMax - m_BoundsMin, glm::vec3(1e-6f));
+    }
+    
+    // The vertex layout is specialized for the influence count
+    switch (m_BoneInfluences) {
+        case 1: packVertices<1>(localBoneIds, vertexPalette, packed); break;
+        case 2: packVertices<2>(localBoneIds, vertexPalette, packed); break;
+        case 8: packVertices<8>(localBoneIds, vertexPalette, packed); break;
+        default: packVertices<4>(localBoneIds, vertexPalette, packed); break;
+    }
+}
+
+void AnimatedModelAsset::uploadMesh(const void* packedVertices) {
+    if (vertices.empty()) return;
+    
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBufferSize(), packedVertices, GL_STATIC_DRAW);
+    setVertexAttributes();
+    
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    
+    // Draw table, ordered by palette so each palette range is bound once and
+    // then by material so submeshes sharing a material are adjacent
+    std::vector<size_t> drawOrder(m_Submeshes.size());
+    for (size_t i = 0; i < drawOrder.size(); i++) drawOrder[i] = i;
+    std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](size_t a, size_t b) {
+        const Submesh& sa = m_Submeshes[a];
+        const Submesh& sb = m_Submeshes[b];
+        if (sa.palette != sb.palette) return sa.palette < sb.palette;
+        return sa.materialIndex < sb.materialIndex;
+    });
+    m_DrawCounts.clear();
+    m_DrawOffsets.clear();
+    m_DrawBaseVertices.clear();
+    m_PaletteDraws.clear();
+    for (size_t i : drawOrder) {
+        const Submesh& submesh = m_Submeshes[i];
+        if (submesh.indexCount == 0) continue;
+        if (m_PaletteDraws.empty() || m_PaletteDraws.back().palette != submesh.palette) {
+            m_PaletteDraws.push_back({ submesh.palette, m_DrawCounts.size(), 0 });
+        }
+        m_PaletteDraws.back().count++;
+        m_DrawCounts.push_back((GLsizei)submesh.indexCount);
+        m_DrawOffsets.push_back((const void*)(submesh.firstIndex * sizeof(unsigned int)));
+        m_DrawBaseVertices.push_back((GLint)submesh.baseVertex);
+    }
+    
+    glBindVertexArray(0);
+    
+    std::cout << "  - Vertex buffer: " << vertexBufferSize() / 1024.0f << " KB (" << m_VertexStride << " bytes per vertex, "
+              << vertices.size() * sizeof(Vertex) / 1024.0f << " KB unpacked)" << std::endl;
+}
+
+void AnimatedModelAsset::setTexCoordAttribute(unsigned int location) const {
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, (GLsizei)m_VertexStride, (void*)m_TexCoordOffset);
+}
+
+std::string AnimatedModelAsset::shaderDefines() const {
+    std::string defines = "#define BONE_INFLUENCES " + std::to_string(m_BoneInfluences) + "\n";
+    if (m_QuantizePositions) defines += "#define QUANTIZED_POSITIONS\n";
+    return defines;
+}
+
+void AnimatedModelAsset::loadTexture(const std::string& filepath) {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    
+    int width, height, nrChannels;
+    stbi_set_flip_vertically_on_load(false);
+    unsigned char* data = stbi_load(filepath.c_str(), &width, &height, &nrChannels, 0);
+    if (data) {
+        GLenum format;
+        if (nrChannels == 1) format = GL_RED;
+        else if (nrChannels == 3) format = GL_RGB;
+        else if (nrChannels == 4) format = GL_RGBA;
+        
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    } else {
+        std::cout << "Failed to load texture: " << filepath << std::endl;
+    }
+    stbi_image_free(data);
+}
+
+void AnimatedModelAsset::draw(const BonePalette& palette) const {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    
+    glBindVertexArray(VAO);
+    drawSubmeshes(palette);
+    glBindVertexArray(0);
+}
+
+void AnimatedModelAsset::drawSubmeshes(const BonePalette& palette) const {
+    for (const auto& draws : m_PaletteDraws) {
+        palette.bind(draws.palette);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_DrawCounts.data() + draws.first, GL_UNSIGNED_INT,
+                                      m_DrawOffsets.data() + draws.first, (GLsizei)draws.count,
+                                      m_DrawBaseVertices.data() + draws.first);
+    }
+}
+
+void AnimatedModelAsset::drawSubmeshes() const {
+    if (m_DrawCounts.empty()) return;
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_DrawCounts.data(), GL_UNSIGNED_INT, m_DrawOffsets.data(),
+                                  (GLsizei)m_DrawCounts.size(), m_DrawBaseVertices.data());
+}
+
+void AnimatedModelAsset::drawSubmeshesInstanced(unsigned int instanceCount,
+                                                const std::function<void(unsigned int palette)>& selectPalette) const {
+    if (instanceCount == 0) return;
+    for (const auto& draws : m_PaletteDraws) {
+        if (selectPalette) selectPalette(draws.palette);
+        for (size_t i = draws.first; i < draws.first + draws.count; i++) {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_DrawCounts[i], GL_UNSIGNED_INT, m_DrawOffsets[i],
+                                              (GLsizei)instanceCount, m_DrawBaseVertices[i]);
+        }
+    }
+}
+
+void AnimatedModelAsset::bakeClips(const aiScene* scene) {
+    // Resample every animation into a fixed-rate clip
+    m_Clips.clear();
+    for (unsigned int i = 0; i < scene->mNumAnimations; i++) {
+        AnimationClip clip;
+        if (bakeAnimationClip(scene->mAnimations[i], m_Skeleton, 0.0f, clip)) {
+            m_Clips.push_back(std::move(clip));
+        }
+    }
+    
+    // Compress the clips and report what they cost compared to the raw Assimp keys
+    size_t sourceBytes = 0, bakedBytes = 0, residentBytes = 0;
+    for (auto& clip : m_Clips) {
+        sourceBytes += clip.sourceMemory;
+        bakedBytes += clip.memoryUsage();
+        residentBytes += (m_ClipErrorBound > 0.0f) ? compressAnimationClip(clip, m_Skeleton, m_ClipErrorBound)
+                                                   : clip.memoryUsage();
+    }
+    if (!m_Clips.empty()) {
+        std::cout << "  - Animation memory: Assimp keys " << sourceBytes / 1024.0f << " KB, baked "
+                  << bakedBytes / 1024.0f << " KB, resident " << residentBytes / 1024.0f << " KB";
+        if (m_ClipErrorBound > 0.0f) {
+            std::cout << " (compressed, error bound " << m_ClipErrorBound << ")";
+        }
+        std::cout << std::endl;
+    }
+}
+
+void AnimatedModelAsset::importClips(const std::string& path) {
+    Assimp::Importer importer;
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_ANIMATIONS, true);
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_PRESERVE_PIVOTS, false);
+    importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_STRICT_MODE, false);
+    const aiScene* scene = importer.ReadFile(path, 0);
+    if (!scene) {
+        std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+        return;
+    }
+    bakeClips(scene);
+}
+
+bool AnimatedModelAsset::saveMeshCache(const std::string& path, uint64_t key,
+                                       const std::vector<uint8_t>& packedVertices) const {
+    return writeMeshCache(path, key, [&](std::ostream& out) {
+        writeBinaryArray(out, vertices);
+        writeBinaryArray(out, indices);
+        writeBinary(out, (uint32_t)m_Submeshes.size());
+        for (const Submesh& submesh : m_Submeshes) {
+            writeBinaryString(out, submesh.name);
+            writeBinary(out, submesh.baseVertex);
+            writeBinary(out, submesh.vertexCount);
+            writeBinary(out, submesh.firstIndex);
+            writeBinary(out, submesh.indexCount);
+            writeBinary(out, submesh.materialIndex);
+            writeBinary(out, submesh.palette);
+        }
+        writeBinary(out, (uint32_t)m_Palettes.size());
+        for (const auto& palette : m_Palettes) writeBinaryArray(out, palette);
+        
+        writeBinary(out, m_BoneCounter);
+        writeBinary(out, (uint32_t)m_BoneInfoMap.size());
+        for (const auto& bone : m_BoneInfoMap) {
+            writeBinaryString(out, bone.first);
+            writeBinary(out, bone.second.id);
+            writeBinary(out, bone.second.offset);
+        }
+        m_Skeleton.write(out);
+        writeBinaryArray(out, m_BoneBounds);
+        writeBinary(out, m_UnskinnedBounds);
+        
+        writeBinary(out, m_BoundsMin);
+        writeBinary(out, m_BoundsMax);
+        writeBinary(out, m_PositionOffset);
+        writeBinary(out, m_PositionScale);
+        writeBinary(out, (uint32_t)m_VertexStride);
+        writeBinary(out, (uint32_t)m_TexCoordOffset);
+        writeBinary(out, (uint32_t)m_NormalOffset);
+        writeBinary(out, (uint32_t)m_InfluencesOffset);
+        writeBinaryArray(out, packedVertices);
+    });
+}
+
+bool AnimatedModelAsset::loadMeshCache(const std::string& path, uint64_t key) {
+    MappedFile file;
+    BinaryReader in(nullptr, 0);
+    if (!openMeshCache(path, key, file, in)) return false;
+    
+    uint32_t submeshCount = 0, paletteCount = 0, boneCount = 0;
+    in.readArray(vertices);
+    in.readArray(indices);
+    // counts the rest of the file cannot hold are garbage and are not allocated
+    bool countsValid = in.read(submeshCount) && submeshCount <= in.remaining() / kMinSubmeshSize;
+    m_Submeshes.resize(countsValid ? submeshCount : 0);
+    for (Submesh& submesh : m_Submeshes) {
+        in.readString(submesh.name);
+        in.read(submesh.baseVertex);
+        in.read(submesh.vertexCount);
+        in.read(submesh.firstIndex);
+        in.read(submesh.indexCount);
+        in.read(submesh.materialIndex);
+        in.read(submesh.palette);
+    }
+    countsValid = countsValid && in.read(paletteCount) && paletteCount <= in.remaining() / kMinPaletteSize;
+    m_Palettes.resize(countsValid ? paletteCount : 0);
+    for (auto& palette : m_Palettes) in.readArray(palette);
+    
+    in.read(m_BoneCounter);
+    countsValid = countsValid && in.read(boneCount) && boneCount <= in.remaining() / kMinBoneSize;
+    for (uint32_t i = 0; i < boneCount && in.ok() && countsValid; i++) {
+        std::string name;
+        BoneInfo bone;
+        in.readString(name);
+        in.read(bone.id);
+        in.read(bone.offset);
+        m_BoneInfoMap[name] = bone;
+    }
+    bool skeletonRead = in.ok() && m_Skeleton.read(in);
+    in.readArray(m_BoneBounds);
+    in.read(m_UnskinnedBounds);
+    
+    uint32_t stride = 0, texCoordOffset = 0, normalOffset = 0, influencesOffset = 0, packedSize = 0;
+    const uint8_t* packedVertices = nullptr;
+    in.read(m_BoundsMin);
+    in.read(m_BoundsMax);
+    in.read(m_PositionOffset);
+    in.read(m_PositionScale);
+    in.read(stride);
+    in.read(texCoordOffset);
+    in.read(normalOffset);
+    in.read(influencesOffset);
+    in.viewArray(packedVertices, packedSize);
+    
+    bool valid = in.ok() && countsValid && skeletonRead && packedSize == vertices.size() * stride &&
+                 m_BoneCounter >= 0 && m_BoneBounds.size() == (size_t)m_BoneCounter;
+    for (const Submesh& submesh : m_Submeshes) {
+        valid = valid && submesh.palette < m_Palettes.size() &&
+                (size_t)submesh.firstIndex + submesh.indexCount <= indices.size() &&
+                (size_t)submesh.baseVertex + submesh.vertexCount <= vertices.size();
+        // indices are relative to the base vertex of their submesh
+        for (unsigned int i = 0; valid && i < submesh.indexCount; i++) {
+            valid = indices[submesh.firstIndex + i] < submesh.vertexCount;
+        }
+    }
+    for (const auto& palette : m_Palettes) {
+        valid = valid && palette.size() <= MAX_PALETTE_BONES;
+        for (size_t i = 0; valid && i < palette.size(); i++) {
+            valid = palette[i] < (unsigned int)m_BoneCounter || palette[i] == PALETTE_IDENTITY_BONE;
+        }
+    }
+    if (!valid) {
+        std::cout << "WARNING::MESH_CACHE: Damaged mesh cache " << path << ", importing the FBX" << std::endl;
+        vertices.clear();
+        indices.clear();
+        m_Submeshes.clear();
+        m_Palettes.clear();
+        m_BoneInfoMap.clear();
+        m_BoneCounter = 0;
+        m_BoneBounds.clear();
+        m_Skeleton = Skeleton();
+        return false;
+    }
+    m_VertexStride = stride;
+    m_TexCoordOffset = texCoordOffset;
+    m_NormalOffset = normalOffset;
+    m_InfluencesOffset = influencesOffset;
+    
+    // the packed vertices go from the mapped pages into the buffer without a copy
+    uploadMesh(packedVertices);
+    return true;
+}
+
+int AnimatedModelAsset::findClip(const std::string& name) const {
+    for (size_t i = 0; i < m_Clips.size(); i++) {
+        if (m_Clips[i].name == name) return (int)i;
+    }
+    return -1;
+}
+
+const AnimationClip& AnimatedModelAsset::acquireClip(unsigned int index) const {
+    return m_ClipLibrary ? m_ClipLibrary->acquire(index) : m_Clips[index];
+}
+
+void AnimatedModelAsset::trimClips() {
+    if (m_ClipLibrary) m_ClipLibrary->trim();
+}
+
+void AnimatedModelAsset::setClipMemoryCap(size_t bytes) {
+    if (m_ClipLibrary) m_ClipLibrary->setMemoryCap(bytes);
+}
+
+size_t AnimatedModelAsset::memoryUsage() const {
+    size_t bytes = sizeof(*this) + vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+    for (const auto& palette : m_Palettes) {
+        bytes += palette.capacity() * sizeof(unsigned int);
+    }
+    bytes += m_BoneBounds.capacity() * sizeof(BoundingBox);
+    for (const auto& clip : m_Clips) {
+        bytes += clip.memoryUsage();
+    }
+    return bytes;
+}
+
+glm::mat4 AnimatedModelAsset::aiMatrix4x4ToGlm(const aiMatrix4x4& from) {
+    glm::mat4 to;
+    to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
+    to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
+    to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
+    to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
+    return to;
+}
+
+void AnimatedModelAsset::setVertexBoneDataToDefault(Vertex& vertex) {
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+        vertex.m_BoneIDs[i] = -1;
+        vertex.m_Weights[i] = 0.0f;
+    }
+}
+
+void AnimatedModelAsset::setVertexBoneData(Vertex& vertex, int boneID, float weight) {
+    // Keep the strongest MAX_BONE_INFLUENCE influences sorted by weight
+    int slot = MAX_BONE_INFLUENCE;
+    while (slot > 0 && (vertex.m_BoneIDs[slot - 1] < 0 || vertex.m_Weights[slot - 1] < weight)) slot--;
+    if (slot == MAX_BONE_INFLUENCE) return;
+    for (int i = MAX_BONE_INFLUENCE - 1; i > slot; --i) {
+        vertex.m_BoneIDs[i] = vertex.m_BoneIDs[i - 1];
+        vertex.m_Weights[i] = vertex.m_Weights[i - 1];
+    }
+    vertex.m_BoneIDs[slot] = boneID;
+    vertex.m_Weights[slot] = weight;
+}
+
+void AnimatedModelAsset::limitBoneInfluences(Vertex& vertex) {
+    float totalWeight = 0.0f;
+    for (int i = 0; i < MAX_BONE_INFLUENCE && vertex.m_BoneIDs[i] >= 0; i++) {
+        totalWeight += vertex.m_Weights[i];
+    }
+    // Vertices the shaders used to leave in bind pose lose their influences
+    if (totalWeight < MIN_BONE_WEIGHT) {
+        setVertexBoneDataToDefault(vertex);
+        return;
+    }
+    
+    // influences are sorted, keep the leading ones above the threshold
+    int kept = 0;
+    float keptWeight = 0.0f;
+    while (kept < m_BoneInfluences && vertex.m_BoneIDs[kept] >= 0 &&
+           (kept == 0 || vertex.m_Weights[kept] >= MIN_BONE_WEIGHT * totalWeight)) {
+        keptWeight += vertex.m_Weights[kept];
+        kept++;
+    }
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
+        if (i < kept) {
+            vertex.m_Weights[i] /= keptWeight;
+        } else {
+            vertex.m_BoneIDs[i] = -1;
+            vertex.m_Weights[i] = 0.0f;
+        }
+    }
+}
+
+void AnimatedModelAsset::extractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const aiScene* scene, unsigned int baseVertex) {
+    std::cout << "  Processing " << mesh->mNumBones << " bones for mesh" << std::endl;
+    
+    for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex) {
+        int boneID = -1;
+        std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
+        
+        if (m_BoneInfoMap.find(boneName) == m_BoneInfoMap.end()) {
+            // no limit here, buildPalettes() splits meshes that reference too many bones
+            BoneInfo newBoneInfo;
+            newBoneInfo.id = m_BoneCounter;
+            newBoneInfo.offset = aiMatrix4x4ToGlm(mesh->mBones[boneIndex]->mOffsetMatrix);
+            m_BoneInfoMap[boneName] = newBoneInfo;
+            boneID = m_BoneCounter;
+            m_BoneCounter++;
+            
+            // Debug: Print foot-related bones
+            if (boneName.find("Foot") != std::string::npos || 
+                boneName.find("Toe") != std::string::npos ||
+                boneName.find("foot") != std::string::npos ||
+                boneName.find("toe") != std::string::npos) {
+                std::cout << "    Found foot bone: " << boneName << " (ID: " << boneID << ")" << std::endl;
+            }
+        } else {
+            boneID = m_BoneInfoMap[boneName].id;
+        }
+        
+        if (boneID == -1) {
+            std::cout << "ERROR:: Invalid bone ID for: " << boneName << std::endl;
+            continue;
+        }
+        
+        auto weights = mesh->mBones[boneIndex]->mWeights;
+        int numWeights = mesh->mBones[boneIndex]->mNumWeights;
+        
+        for (int weightIndex = 0; weightIndex < numWeights; ++weightIndex) {
+            int vertexId = weights[weightIndex].mVertexId;
+            float weight = weights[weightIndex].mWeight;
+            
+            // weights use mesh-local vertex ids
+            if (vertexId >= (int)mesh->mNumVertices) {
+                std::cout << "ERROR:: Vertex ID " << vertexId << " out of range (max: " << mesh->mNumVertices << ")" << std::endl;
+                continue;
+            }
+            
+            setVertexBoneData(vertices[baseVertex + vertexId], boneID, weight);
+        }
+    }
+    
+    // Validate the weights of this mesh after processing all bones
+    int verticesWithZeroWeight = 0;
+    for (size_t i = baseVertex; i < vertices.size(); ++i) {
+        float totalWeight = 0.0f;
+        bool hasValidBone = false;
+        
+        for (int j = 0; j < MAX_BONE_INFLUENCE; ++j) {
+            if (vertices[i].m_BoneIDs[j] >= 0) {
+                hasValidBone = true;
+                totalWeight += vertices[i].m_Weights[j];
+            }
+        }
+        
+        if (!hasValidBone || totalWeight < 0.01f) {
+            verticesWithZeroWeight++;
+            // Debug: Print first few problematic vertices (likely foot vertices)
+            if (verticesWithZeroWeight <= 10) {
+                std::cout << "WARNING:: Vertex " << i << " has no valid bone weights (total: " << totalWeight << ")" << std::endl;
+            }
+        }
+    }
+    
+    if (verticesWithZeroWeight > 0) {
+        std::cout << "WARNING:: " << verticesWithZeroWeight << " vertices have zero or invalid bone weights!" << std::endl;
+    }
+}
@@ -0,0 +1,469 @@
+#include "header/animation_clip.h"
+#include "header/clip_sampling.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+static glm::vec3 aiVector3DToGlm(const aiVector3D& vec) {
+    return glm::vec3(vec.x, vec.y, vec.z);
+}
+
+static glm::quat aiQuaternionToGlm(const aiQuaternion& pOrientation) {
+    return glm::quat(pOrientation.w, pOrientation.x, pOrientation.y, pOrientation.z);
+}
+
+// Find the key pair [i, i + 1] to interpolate at animationTime, same result as
+// scanning from key 0: the first i with animationTime < keys[i + 1], or the last pair.
+// The cached cursor makes forward playback O(1); jumps fall back to binary search.
+template <typename KeyType>
+static unsigned int findKeyIndex(const KeyType* keys, unsigned int numKeys, float animationTime, unsigned int& cursor) {
+    const unsigned int lastPair = numKeys - 2;
+    auto isPair = [&](unsigned int i) {
+        return (i == 0 || !(animationTime < (float)keys[i].mTime)) &&
+               (i == lastPair || animationTime < (float)keys[i + 1].mTime);
+    };
+    
+    if (cursor <= lastPair) {
+        if (isPair(cursor)) return cursor;
+        if (cursor < lastPair && isPair(cursor + 1)) return ++cursor;
+    }
+    
+    // backward seek, loop wraparound or a skip of more than one key
+    const KeyType* upper = std::upper_bound(keys + 1, keys + numKeys, animationTime,
+        [](float time, const KeyType& key) { return time < (float)key.mTime; });
+    unsigned int index = (unsigned int)(upper - (keys + 1));
+    cursor = std::min(index, lastPair);
+    return cursor;
+}
+
+static float keyFactor(double startTime, double endTime, float animationTime) {
+    float deltaTime = (float)(endTime - startTime);
+    float factor = 0.0f;
+    if (deltaTime > 0.0001f) {
+        factor = (animationTime - (float)startTime) / deltaTime;
+        factor = glm::clamp(factor, 0.0f, 1.0f);
+    }
+    return factor;
+}
+
+static glm::vec3 sampleVectorKeys(const aiVectorKey* keys, unsigned int numKeys, float animationTime,
+                                  unsigned int& cursor, const glm::vec3& fallback) {
+    if (numKeys == 0) return fallback;
+    if (numKeys == 1) return aiVector3DToGlm(keys[0].mValue);
+    
+    unsigned int index = findKeyIndex(keys, numKeys, animationTime, cursor);
+    float factor = keyFactor(keys[index].mTime, keys[index + 1].mTime, animationTime);
+    return glm::mix(aiVector3DToGlm(keys[index].mValue), aiVector3DToGlm(keys[index + 1].mValue), factor);
+}
+
+static glm::quat sampleQuatKeys(const aiQuatKey* keys, unsigned int numKeys, float animationTime, unsigned int& cursor) {
+    if (numKeys == 0) return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    if (numKeys == 1) return aiQuaternionToGlm(keys[0].mValue);
+    
+    unsigned int index = findKeyIndex(keys, numKeys, animationTime, cursor);
+    float factor = keyFactor(keys[index].mTime, keys[index + 1].mTime, animationTime);
+    return glm::slerp(aiQuaternionToGlm(keys[index].mValue), aiQuaternionToGlm(keys[index + 1].mValue), factor);
+}
+
+size_t CompressedClip::memoryUsage() const {
+    return firstKey.capacity() * sizeof(uint32_t)
+         + keyCounts.capacity() * sizeof(uint16_t)
+         + rangeMin.capacity() * sizeof(glm::vec3)
+         + rangeExtent.capacity() * sizeof(glm::vec3)
+         + keyFrames.capacity() * sizeof(uint16_t)
+         + keyData.capacity() * sizeof(uint16_t);
+}
+
+size_t AnimationClip::memoryUsage() const {
+    return sizeof(AnimationClip)
+         + name.capacity()
+         + trackNodes.capacity() * sizeof(int)
+         + translations.capacity() * sizeof(glm::vec3)
+         + rotations.capacity() * sizeof(glm::quat)
+         + scales.capacity() * sizeof(glm::vec3)
+         + compressed.memoryUsage();
+}
+
+bool bakeAnimationClip(const aiAnimation* animation, const Skeleton& skeleton, float sampleRate, AnimationClip& clip) {
+    if (!animation || skeleton.size() == 0) return false;
+    
+    // Handle Mixamo FBX files where mTicksPerSecond might be 0
+    double ticksPerSecond = animation->mTicksPerSecond;
+    if (ticksPerSecond == 0.0) {
+        ticksPerSecond = 25.0; // Default to 25 FPS for Mixamo animations
+    }
+    float durationTicks = (float)animation->mDuration;
+    
+    clip.name = animation->mName.C_Str();
+    clip.duration = (float)(animation->mDuration / ticksPerSecond);
+    
+    if (sampleRate <= 0.0f) {
+        // match the densest track so the resampling does not drop detail
+        unsigned int maxKeys = 2;
+        for (unsigned int i = 0; i < animation->mNumChannels; i++) {
+            const aiNodeAnim* channel = animation->mChannels[i];
+            maxKeys = std::max(maxKeys, std::max(channel->mNumRotationKeys,
+                               std::max(channel->mNumPositionKeys, channel->mNumScalingKeys)));
+        }
+        sampleRate = (clip.duration > 0.0f) ? std::round((maxKeys - 1) / clip.duration) : 30.0f;
+        sampleRate = glm::clamp(sampleRate, 30.0f, 120.0f);
+    }
+    clip.frameCount = (unsigned int)std::ceil(clip.duration * sampleRate - 0.001f) + 1;
+    clip.frameCount = std::max(clip.frameCount, 2u);
+    // stretch the rate slightly so the last frame lands exactly on the clip end
+    clip.sampleRate = (clip.duration > 0.0f) ? (clip.frameCount - 1) / clip.duration : sampleRate;
+    sampleRate = clip.sampleRate;
+    
+    // Bind channels to skeleton nodes, first channel wins on duplicate names
+    std::vector<const aiNodeAnim*> nodeChannels(skeleton.size(), nullptr);
+    for (unsigned int i = 0; i < animation->mNumChannels; i++) {
+        const aiNodeAnim* channel = animation->mChannels[i];
+        int nodeIndex = skeleton.findNode(channel->mNodeName.data);
+        if (nodeIndex < 0 || nodeChannels[nodeIndex]) continue;
+        nodeChannels[nodeIndex] = channel;
+    }
+    // in node order, so every skeleton LOD level samples a prefix of the tracks
+    std::vector<const aiNodeAnim*> channels;
+    clip.trackNodes.clear();
+    for (size_t node = 0; node < nodeChannels.size(); node++) {
+        if (!nodeChannels[node]) continue;
+        clip.trackNodes.push_back((int)node);
+        channels.push_back(nodeChannels[node]);
+    }
+    
+    clip.sourceMemory = 0;
+    for (const aiNodeAnim* channel : channels) {
+        clip.sourceMemory += sizeof(aiNodeAnim)
+                           + channel->mNumPositionKeys * sizeof(aiVectorKey)
+                           + channel->mNumRotationKeys * sizeof(aiQuatKey)
+                           + channel->mNumScalingKeys * sizeof(aiVectorKey);
+    }
+    
+    if (channels.size() < animation->mNumChannels) {
+        std::cout << "WARNING:: " << (animation->mNumChannels - channels.size())
+                  << " animation channels do not match any node" << std::endl;
+    }
+    
+    const size_t frameCount = clip.frameCount;
+    clip.translations.resize(channels.size() * frameCount);
+    clip.rotations.resize(channels.size() * frameCount);
+    clip.scales.resize(channels.size() * frameCount);
+    
+    for (size_t track = 0; track < channels.size(); track++) {
+        const aiNodeAnim* nodeAnim = channels[track];
+        unsigned int positionCursor = 0, rotationCursor = 0, scalingCursor = 0;
+        glm::vec3* translations = &clip.translations[track * frameCount];
+        glm::quat* rotations = &clip.rotations[track * frameCount];
+        glm::vec3* scales = &clip.scales[track * frameCount];
+        
+        for (size_t frame = 0; frame < frameCount; frame++) {
+            float seconds = std::min(frame / sampleRate, clip.duration);
+            float animationTime = std::min((float)(seconds * ticksPerSecond), durationTicks);
+            
+            translations[frame] = sampleVectorKeys(nodeAnim->mPositionKeys, nodeAnim->mNumPositionKeys,
+                                                   animationTime, positionCursor, glm::vec3(0.0f));
+            scales[frame] = sampleVectorKeys(nodeAnim->mScalingKeys, nodeAnim->mNumScalingKeys,
+                                             animationTime, scalingCursor, glm::vec3(1.0f));
+            
+            glm::quat rotation = sampleQuatKeys(nodeAnim->mRotationKeys, nodeAnim->mNumRotationKeys,
+                                                animationTime, rotationCursor);
+            // keep neighbouring samples in the same hemisphere
+            if (frame > 0 && glm::dot(rotation, rotations[frame - 1]) < 0.0f) {
+                rotation = -rotation;
+            }
+            rotations[frame] = rotation;
+        }
+    }
+    
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Compression
+// ---------------------------------------------------------------------------
+
+static const float kHalfSqrt2 = 0.70710678f;
+static const size_t kMaxKeySpan = 255;   // bounds the O(span^2) key reduction
+
+// Smallest-three: drop the largest component (recomputed from unit length),
+// store its index in 2 bits and the other three in 15 bits each
+static void packQuaternion(const glm::quat& q, uint16_t* out) {
+    float c[4] = { q.x, q.y, q.z, q.w };
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (std::fabs(c[i]) > std::fabs(c[largest])) largest = i;
+    }
+    float sign = (c[largest] < 0.0f) ? -1.0f : 1.0f;
+    
+    uint64_t bits = (uint64_t)largest << 45;
+    int shift = 30;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        // remaining components lie in [-1/sqrt(2), 1/sqrt(2)]
+        float v = glm::clamp(c[i] * sign * kHalfSqrt2 + 0.5f, 0.0f, 1.0f);
+        bits |= (uint64_t)(v * 32767.0f + 0.5f) << shift;
+        shift -= 15;
+    }
+    out[0] = (uint16_t)(bits >> 32);
+    out[1] = (uint16_t)(bits >> 16);
+    out[2] = (uint16_t)bits;
+}
+
+static glm::quat unpackQuaternion(const uint16_t* in) {
+    uint64_t bits = ((uint64_t)in[0] << 32) | ((uint64_t)in[1] << 16) | (uint64_t)in[2];
+    int largest = (int)(bits >> 45) & 3;
+    
+    float c[4];
+    float sum = 0.0f;
+    int shift = 30;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest) continue;
+        c[i] = (((bits >> shift) & 0x7FFF) / 32767.0f - 0.5f) / kHalfSqrt2;
+        sum += c[i] * c[i];
+        shift -= 15;
+    }
+    c[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+    return glm::quat(c[3], c[0], c[1], c[2]);
+}
+
+static void packVector(const glm::vec3& v, const glm::vec3& rangeMin, const glm::vec3& rangeExtent, uint16_t* out) {
+    for (int i = 0; i < 3; i++) {
+        float t = (rangeExtent[i] > 0.0f) ? (v[i] - rangeMin[i]) / rangeExtent[i] : 0.0f;
+        out[i] = (uint16_t)(glm::clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+    }
+}
+
+static glm::vec3 unpackVector(const uint16_t* in, const glm::vec3& rangeMin, const glm::vec3& rangeExtent) {
+    return rangeMin + rangeExtent * glm::vec3(in[0], in[1], in[2]) * (1.0f / 65535.0f);
+}
+
+static float rotationAngle(const glm::quat& a, const glm::quat& b) {
+    float d = std::min(std::fabs(glm::dot(a, b)), 1.0f);
+    return 2.0f * std::acos(d);
+}
+
+// Greedy key reduction: from the last kept key, extend the segment while
+// interpolating between the (quantized) end keys keeps every skipped frame
+// within the bound. errorAt(approx, frame) returns the error in model units.
+template <typename T, typename Interpolate, typename ErrorAt>
+static void reduceKeys(const std::vector<T>& decoded, size_t frameCount, float errorBound,
+                       Interpolate interpolate, ErrorAt errorAt, std::vector<uint16_t>& keptFrames) {
+    keptFrames.clear();
+    keptFrames.push_back(0);
+    
+    // constant channel: a single key
+    bool constant = true;
+    for (size_t frame = 1; frame < frameCount && constant; frame++) {
+        constant = errorAt(decoded[0], frame) <= errorBound;
+    }
+    if (constant) return;
+    
+    size_t start = 0;
+    while (start < frameCount - 1) {
+        size_t end = start + 1;
+        while (end + 1 < frameCount && end + 1 - start <= kMaxKeySpan) {
+            size_t candidate = end + 1;
+            bool withinBound = true;
+            for (size_t frame = start + 1; frame < candidate && withinBound; frame++) {
+                float t = (float)(frame - start) / (float)(candidate - start);
+                withinBound = errorAt(interpolate(decoded[start], decoded[candidate], t), frame) <= errorBound;
+            }
+            if (!withinBound) break;
+            end = candidate;
+        }
+        keptFrames.push_back((uint16_t)end);
+        start = end;
+    }
+}
+
+size_t compressAnimationClip(AnimationClip& clip, const Skeleton& skeleton, float errorBound) {
+    if (clip.isCompressed() || clip.trackCount() == 0) return clip.memoryUsage();
+    if (clip.frameCount > 65535) {
+        std::cout << "WARNING:: Clip " << clip.name << " has too many frames to compress" << std::endl;
+        return clip.memoryUsage();
+    }
+    
+    // Bind pose in model space gives the lever arm of every joint: rotation
+    // errors are scaled by the distance to the farthest descendant joint and
+    // translation errors by the accumulated parent scale
+    const size_t nodeCount = skeleton.size();
+    std::vector<glm::mat4> bindGlobals(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+        glm::mat4 local = composeTransform(skeleton.bindTranslations[i], skeleton.bindRotations[i], skeleton.bindScales[i]);
+        int parent = skeleton.parents[i];
+        bindGlobals[i] = (parent < 0) ? local : bindGlobals[parent] * local;
+    }
+    std::vector<float> tipDistance(nodeCount, 0.0f);
+    std::vector<float> parentScale(nodeCount, 1.0f);
+    for (size_t i = nodeCount; i-- > 1;) {
+        int parent = skeleton.parents[i];
+        if (parent < 0) continue;
+        float boneLength = glm::length(glm::vec3(bindGlobals[i][3]) - glm::vec3(bindGlobals[parent][3]));
+        tipDistance[parent] = std::max(tipDistance[parent], boneLength + tipDistance[i]);
+        parentScale[i] = glm::length(glm::vec3(bindGlobals[parent][0]));
+        // leaf joints still carry skin, use the incoming bone as their extent
+        if (tipDistance[i] == 0.0f) tipDistance[i] = boneLength;
+    }
+    
+    const size_t frameCount = clip.frameCount;
+    const size_t trackCount = clip.trackCount();
+    CompressedClip& out = clip.compressed;
+    out.firstKey.resize(trackCount * CLIP_CHANNEL_COUNT);
+    out.keyCounts.resize(trackCount * CLIP_CHANNEL_COUNT);
+    out.rangeMin.assign(trackCount * CLIP_CHANNEL_COUNT, glm::vec3(0.0f));
+    out.rangeExtent.assign(trackCount * CLIP_CHANNEL_COUNT, glm::vec3(0.0f));
+    out.keyFrames.clear();
+    out.keyData.clear();
+    
+    std::vector<uint16_t> packed(frameCount * 3);
+    std::vector<glm::vec3> decodedVectors(frameCount);
+    std::vector<glm::quat> decodedRotations(frameCount);
+    std::vector<uint16_t> keptFrames;
+    
+    auto emitKeys = [&](size_t slot) {
+        out.firstKey[slot] = (uint32_t)out.keyFrames.size();
+        out.keyCounts[slot] = (uint16_t)keptFrames.size();
+        for (uint16_t frame : keptFrames) {
+            out.keyFrames.push_back(frame);
+            out.keyData.insert(out.keyData.end(), &packed[frame * 3], &packed[frame * 3] + 3);
+        }
+    };
+    
+    for (size_t track = 0; track < trackCount; track++) {
+        int node = clip.trackNodes[track];
+        float lever = std::max(tipDistance[node], 1e-3f);
+        
+        // translations and scales: range quantization
+        for (int channel : { (int)CLIP_TRANSLATION, (int)CLIP_SCALE }) {
+            const glm::vec3* exact = (channel == CLIP_TRANSLATION) ? &clip.translations[track * frameCount]
+                                                                   : &clip.scales[track * frameCount];
+            float unitScale = (channel == CLIP_TRANSLATION) ? parentScale[node] : lever;
+            size_t slot = track * CLIP_CHANNEL_COUNT + channel;
+            
+            glm::vec3 minValue = exact[0], maxValue = exact[0];
+            for (size_t frame = 1; frame < frameCount; frame++) {
+                minValue = glm::min(minValue, exact[frame]);
+                maxValue = glm::max(maxValue, exact[frame]);
+            }
+            out.rangeMin[slot] = minValue;
+            out.rangeExtent[slot] = maxValue - minValue;
+            
+            for (size_t frame = 0; frame < frameCount; frame++) {
+                packVector(exact[frame], minValue, out.rangeExtent[slot], &packed[frame * 3]);
+                decodedVectors[frame] = unpackVector(&packed[frame * 3], minValue, out.rangeExtent[slot]);
+            }
+            reduceKeys(decodedVectors, frameCount, errorBound,
+                [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); },
+                [&](const glm::vec3& approx, size_t frame) { return glm::length(approx - exact[frame]) * unitScale; },
+                keptFrames);
+            emitKeys(slot);
+        }
+        
+        // rotations: smallest-three
+        const glm::quat* exact = &clip.rotations[track * frameCount];
+        for (size_t frame = 0; frame < frameCount; frame++) {
+            packQuaternion(exact[frame], &packed[frame * 3]);
+            decodedRotations[frame] = unpackQuaternion(&packed[frame * 3]);
+        }
+        reduceKeys(decodedRotations, frameCount, errorBound,
+            [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); },
+            [&](const glm::quat& approx, size_t frame) { return rotationAngle(approx, exact[frame]) * lever; },
+            keptFrames);
+        emitKeys(track * CLIP_CHANNEL_COUNT + CLIP_ROTATION);
+    }
+    
+    out.keyFrames.shrink_to_fit();
+    out.keyData.shrink_to_fit();
+    
+    // the raw frames are no longer needed
+    std::vector<glm::vec3>().swap(clip.translations);
+    std::vector<glm::quat>().swap(clip.rotations);
+    std::vector<glm::vec3>().swap(clip.scales);
+    
+    return clip.memoryUsage();
+}
+
+// Locate the key pair around framePosition and return the blend factor
+static float findCompressedKeys(const uint16_t* frames, unsigned int keyCount, float framePosition, unsigned int& key) {
+    const uint16_t* upper = std::upper_bound(frames + 1, frames + keyCount, framePosition,
+        [](float position, uint16_t frame) { return position < (float)frame; });
+    key = std::min((unsigned int)(upper - (frames + 1)), keyCount - 2);
+    float span = (float)(frames[key + 1] - frames[key]);
+    return glm::clamp((framePosition - frames[key]) / span, 0.0f, 1.0f);
+}
+
+// Rotations are slerp-ed here, or with a batch only their key pairs are
+// collected, lane i for track i
+static void sampleCompressedClip(const AnimationClip& clip, float framePosition, Pose& pose, size_t trackCount,
+                                 RotationBatch* batch) {
+    const CompressedClip& data = clip.compressed;
+    
+    for (size_t track = 0; track < trackCount; track++) {
+        int node = clip.trackNodes[track];
+        for (int channel = 0; channel < CLIP_CHANNEL_COUNT; channel++) {
+            size_t slot = track * CLIP_CHANNEL_COUNT + channel;
+            unsigned int first = data.firstKey[slot];
+            unsigned int keyCount = data.keyCounts[slot];
+            unsigned int key = 0;
+            float factor = 0.0f;
+            if (keyCount > 1) {
+                factor = findCompressedKeys(&data.keyFrames[first], keyCount, framePosition, key);
+            }
+            const uint16_t* a = &data.keyData[(first + key) * 3];
+            const uint16_t* b = (keyCount > 1) ? a + 3 : a;
+            
+            if (channel == CLIP_ROTATION) {
+                if (batch) batch->set(track, unpackQuaternion(a), unpackQuaternion(b), factor);
+                else pose.rotations[node] = glm::slerp(unpackQuaternion(a), unpackQuaternion(b), factor);
+            } else {
+                glm::vec3 value = glm::mix(unpackVector(a, data.rangeMin[slot], data.rangeExtent[slot]),
+                                           unpackVector(b, data.rangeMin[slot], data.rangeExtent[slot]), factor);
+                if (channel == CLIP_TRANSLATION) pose.translations[node] = value;
+                else pose.scales[node] = value;
+            }
+        }
+    }
+}
+
+void sampleAnimationClip(const AnimationClip& clip, float timeInSeconds, Pose& pose, size_t nodeCount) {
+    float time = (clip.duration > 0.0f) ? std::fmod(timeInSeconds, clip.duration) : 0.0f;
+    if (time < 0.0f) time += clip.duration;
+    
+    float framePosition = time * clip.sampleRate;
+    
+    // tracks are sorted by node, the ones kept at this LOD are a prefix
+    const size_t trackCount = std::lower_bound(clip.trackNodes.begin(), clip.trackNodes.end(), nodeCount,
+        [](int node, size_t count) { return (size_t)node < count; }) - clip.trackNodes.begin();
+    
+    ClipSamplingKernel kernel = getClipSamplingKernel();
+    static thread_local RotationBatch batchStorage;
+    RotationBatch* batch = nullptr;
+    if (kernel != CLIP_SAMPLING_EXACT) {
+        batch = &batchStorage;
+        batch->resize(trackCount);
+    }
+    
+    if (clip.isCompressed()) {
+        sampleCompressedClip(clip, framePosition, pose, trackCount, batch);
+    } else {
+        unsigned int frame = std::min((unsigned int)framePosition, clip.frameCount - 2);
+        float factor = std::min(framePosition - (float)frame, 1.0f);
+        
+        const size_t frameCount = clip.frameCount;
+        for (size_t track = 0; track < trackCount; track++) {
+            size_t index = track * frameCount + frame;
+            int node = clip.trackNodes[track];
+            pose.translations[node] = glm::mix(clip.translations[index], clip.translations[index + 1], factor);
+            if (batch) batch->set(track, clip.rotations[index], clip.rotations[index + 1], factor);
+            else pose.rotations[node] = glm::slerp(clip.rotations[index], clip.rotations[index + 1], factor);
+            pose.scales[node] = glm::mix(clip.scales[index], clip.scales[index + 1], factor);
+        }
+    }
+    
+    if (batch) {
+        interpolateRotations(*batch, kernel);
+        for (size_t track = 0; track < trackCount; track++) {
+            pose.rotations[clip.trackNodes[track]] = batch->result(track);
+        }
+    }
+}
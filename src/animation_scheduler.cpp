@@ -0,0 +1,108 @@
+#include "header/animation_scheduler.h"
+#include <algorithm>
+#include <chrono>
+
+AnimationScheduler::AnimationScheduler(float budgetMicroseconds) : m_Budget(budgetMicroseconds) {
+}
+
+AnimatedCharacter& AnimationScheduler::addCharacter(std::shared_ptr<const AnimatedModelAsset> asset) {
+    m_Characters.emplace_back(new AnimatedCharacter(asset));
+    AnimatedCharacter& character = *m_Characters.back();
+    // staggers characters that share an interval over different frames
+    character.phase = (unsigned int)(m_Characters.size() - 1);
+    return character;
+}
+
+void AnimationScheduler::update(const glm::mat4& view, const glm::mat4& projection) {
+    typedef std::chrono::high_resolution_clock Clock;
+    Clock::time_point start = Clock::now();
+    m_Frame++;
+    
+    m_Due.clear();
+    for (auto& pointer : m_Characters) {
+        AnimatedCharacter& character = *pointer;
+        character.timeStep = character.animationTime - character.lastAnimationTime;
+        character.lastAnimationTime = character.animationTime;
+        
+        character.visible = !character.allowCulling || character.instance.isVisible(character.model, view, projection);
+        if (!character.visible) {
+            m_Stats.culled++;
+            continue;
+        }
+        // the skeleton LOD levels double as update rates
+        unsigned int lod = character.instance.selectLod(character.model, view, projection);
+        if (character.forcedLod >= 0) character.instance.setLod(character.forcedLod);
+        character.interval = character.focus ? 1 : (1u << lod);
+        
+        if (!character.evaluated || m_Frame - character.lastUpdateFrame >= character.interval) {
+            m_Due.push_back(&character);
+        } else {
+            blend(character);
+        }
+    }
+    
+    // Focused and never evaluated characters first, then the most overdue
+    unsigned long frame = m_Frame;
+    std::sort(m_Due.begin(), m_Due.end(), [frame](const AnimatedCharacter* a, const AnimatedCharacter* b) {
+        bool urgentA = a->focus || !a->evaluated;
+        bool urgentB = b->focus || !b->evaluated;
+        if (urgentA != urgentB) return urgentA;
+        return (float)(frame - a->lastUpdateFrame) / a->interval > (float)(frame - b->lastUpdateFrame) / b->interval;
+    });
+    
+    for (size_t i = 0; i < m_Due.size(); i++) {
+        AnimatedCharacter* character = m_Due[i];
+        Clock::time_point before = Clock::now();
+        double elapsed = std::chrono::duration<double, std::micro>(before - start).count();
+        // An evaluation may take as long as the slowest recent one, and every
+        // character after this one still needs at least a blend
+        double reserve = m_PeakCost + (double)(m_Due.size() - i - 1) * m_AverageBlendCost;
+        bool urgent = character->focus || !character->evaluated;
+        if (!urgent && elapsed + reserve > m_Budget) {
+            m_Stats.deferred++;
+            blend(*character);
+            continue;
+        }
+        evaluate(*character);
+        double cost = std::chrono::duration<double, std::micro>(Clock::now() - before).count();
+        m_PeakCost = std::max(cost, m_PeakCost * 0.99);
+    }
+    
+    m_Stats.lastFrameMicroseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+void AnimationScheduler::evaluate(AnimatedCharacter& character) {
+    AnimatedModelInstance& instance = character.instance;
+    if (character.interval <= 1) {
+        instance.updateAnimation(character.animationTime);
+        character.blending = false;
+    } else {
+        // Evaluate where the character will be at its next update and blend
+        // towards it from the palette shown now
+        AnimatedModelInstance::decomposePalette(instance.m_FinalBoneMatrices, character.fromPalette);
+        character.fromTime = character.animationTime;
+        character.toTime = character.animationTime + character.timeStep * character.interval;
+        instance.updateAnimation(character.toTime);
+        AnimatedModelInstance::decomposePalette(instance.m_FinalBoneMatrices, character.toPalette);
+        character.blending = character.evaluated;
+        if (character.blending) {
+            instance.blendPalettes(character.fromPalette, character.toPalette, 0.0f);
+        }
+    }
+    
+    character.lastUpdateFrame = character.evaluated ? m_Frame : m_Frame - character.phase % character.interval;
+    character.evaluated = true;
+    m_Stats.evaluations++;
+}
+
+void AnimationScheduler::blend(AnimatedCharacter& character) {
+    if (!character.blending) return;
+    typedef std::chrono::high_resolution_clock Clock;
+    Clock::time_point before = Clock::now();
+    float span = character.toTime - character.fromTime;
+    float t = (span != 0.0f) ? (character.animationTime - character.fromTime) / span : 1.0f;
+    character.instance.blendPalettes(character.fromPalette, character.toPalette, std::min(std::max(t, 0.0f), 1.0f));
+    m_Stats.interpolations++;
+    double cost = std::chrono::duration<double, std::micro>(Clock::now() - before).count();
+    m_AverageBlendCost = (m_AverageBlendCost == 0.0) ? cost : m_AverageBlendCost * 0.9 + cost * 0.1;
+}
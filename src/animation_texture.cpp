@@ -0,0 +1,50 @@
+#include "header/animation_texture.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+AnimationTextureLayout fitAnimationTexture(float duration, float frameRate, size_t texelsPerFrame,
+                                           unsigned int maxWidth, const char* log) {
+    AnimationTextureLayout layout;
+    // Whole frames over the clip so the loop closes, the rate is adjusted to fit
+    layout.frameCount = std::max(1u, (unsigned int)std::lround(duration * frameRate));
+    layout.frameRate = (duration > 0.0f) ? layout.frameCount / duration : frameRate;
+    
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    size_t rows = (size_t)std::max(maxSize, 0);
+    size_t width = std::min<size_t>(maxWidth, rows);
+    size_t maxFrames = width * rows / std::max<size_t>(texelsPerFrame, 1);
+    if (maxFrames == 0) {
+        std::cout << "ERROR::" << log << ":: A frame of " << texelsPerFrame << " texels does not fit a " << maxSize
+                  << " texture" << std::endl;
+        layout.frameCount = 0;
+        return layout;
+    }
+    if (layout.frameCount > maxFrames) {
+        layout.frameCount = (unsigned int)maxFrames;
+        layout.frameRate = layout.frameCount / duration;
+        std::cout << "WARNING::" << log << ":: Frame rate lowered to " << layout.frameRate
+                  << " fps to fit GL_MAX_TEXTURE_SIZE " << maxSize << std::endl;
+    }
+    
+    size_t texels = (size_t)layout.frameCount * texelsPerFrame;
+    layout.width = (unsigned int)std::min(texels, width);
+    layout.height = (unsigned int)((texels + layout.width - 1) / layout.width);
+    return layout;
+}
+
+unsigned int uploadAnimationTexture(const AnimationTextureLayout& layout, GLenum internalFormat,
+                                    const std::vector<glm::vec4>& texels) {
+    unsigned int texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, layout.width, layout.height, 0, GL_RGBA, GL_FLOAT, texels.data());
+    // fetched with texelFetch, frames are interpolated in the shader
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
@@ -0,0 +1,81 @@
+#include "header/bone_animation_texture.h"
+#include "header/animated_model.h"
+#include "header/animation_texture.h"
+#include <iostream>
+
+BoneAnimationTexture::BoneAnimationTexture(std::shared_ptr<const AnimatedModelAsset> asset, unsigned int clipIndex, float frameRate)
+    : m_FrameRate(frameRate > 0.0f ? frameRate : 30.0f) {
+    bake(asset, clipIndex);
+}
+
+BoneAnimationTexture::~BoneAnimationTexture() {
+    if (m_Texture) glDeleteTextures(1, &m_Texture);
+}
+
+void BoneAnimationTexture::bake(std::shared_ptr<const AnimatedModelAsset> asset, unsigned int clipIndex) {
+    if (clipIndex >= asset->getClipCount() || asset->m_Palettes.empty()) {
+        std::cout << "ERROR::BAT:: Nothing to bake for clip " << clipIndex << std::endl;
+        return;
+    }
+    
+    m_EntryCount = 0;
+    m_PaletteBases.clear();
+    for (const auto& palette : asset->m_Palettes) {
+        m_PaletteBases.push_back((int)m_EntryCount);
+        m_EntryCount += (unsigned int)palette.size();
+    }
+    
+    AnimationTextureLayout layout = fitAnimationTexture(asset->getClipDuration(clipIndex), m_FrameRate,
+                                                        (size_t)m_EntryCount * 3, BAT_TEXTURE_WIDTH, "BAT");
+    m_FrameCount = layout.frameCount;
+    if (m_FrameCount == 0) return;
+    m_FrameRate = layout.frameRate;
+    m_Width = layout.width;
+    m_Height = layout.height;
+    
+    // The pose comes from the same evaluation as a live instance; the bounds
+    // of every frame come with it
+    AnimatedModelInstance instance(asset);
+    instance.playClip(clipIndex);
+    std::vector<glm::vec4> texelData((size_t)m_Width * m_Height, glm::vec4(0.0f));
+    const glm::mat4 identity(1.0f);
+    m_Bounds.reset();
+    for (unsigned int frame = 0; frame < m_FrameCount; frame++) {
+        instance.updateAnimation(frame / m_FrameRate);
+        m_Bounds.expand(instance.getBounds());
+        glm::vec4* out = &texelData[(size_t)frame * m_EntryCount * 3];
+        for (const auto& palette : asset->m_Palettes) {
+            for (unsigned int bone : palette) {
+                const glm::mat4& matrix = bone < instance.m_FinalBoneMatrices.size() ? instance.m_FinalBoneMatrices[bone] : identity;
+                glm::mat4 rows = glm::transpose(matrix);
+                out[0] = rows[0];
+                out[1] = rows[1];
+                out[2] = rows[2];
+                out += 3;
+            }
+        }
+    }
+    
+    m_Texture = uploadAnimationTexture(layout, GL_RGBA32F, texelData);
+    
+    std::cout << "Bone animation texture baked: clip '" << asset->getClipName(clipIndex) << "', " << m_FrameCount
+              << " frames at " << m_FrameRate << " fps, " << m_EntryCount << " palette entries, " << m_Width << "x"
+              << m_Height << " (" << textureBytes() / 1024.0f << " KB)" << std::endl;
+}
+
+void BoneAnimationTexture::bind(unsigned int unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+}
+
+void BoneAnimationTexture::setUniforms(shader_program_t& program, unsigned int unit) const {
+    program.set_uniform_value("batTexture", (int)unit);
+    program.set_uniform_value("batEntryCount", (int)m_EntryCount);
+    program.set_uniform_value("batFrameCount", (int)m_FrameCount);
+    program.set_uniform_value("batFrameRate", m_FrameRate);
+    program.set_uniform_value("batPaletteBase", 0);
+}
+
+void BoneAnimationTexture::setPalette(shader_program_t& program, unsigned int palette) const {
+    program.set_uniform_value("batPaletteBase", palette < m_PaletteBases.size() ? m_PaletteBases[palette] : 0);
+}
@@ -0,0 +1,78 @@
+#include "header/bone_palette.h"
+#include <iostream>
+#include <algorithm>
+
+BonePalette::BonePalette(unsigned int maxBones, bool packed3x4)
+    : m_MaxBones(std::max(maxBones, 1u)), m_Packed(packed3x4) {
+    GLint maxBlockSize = 0;
+    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+    if (maxBlockSize > 0 && blockSize() > (size_t)maxBlockSize) {
+        std::cout << "WARNING:: Bone palette of " << blockSize() << " bytes exceeds GL_MAX_UNIFORM_BLOCK_SIZE ("
+                  << maxBlockSize << ")" << std::endl;
+    }
+    
+    // bound ranges have to start on the offset alignment
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    size_t align = alignment > 0 ? (size_t)alignment : 256;
+    m_RangeStride = (blockSize() + align - 1) / align * align;
+    
+    glGenBuffers(1, &m_Buffer);
+}
+
+BonePalette::~BonePalette() {
+    if (m_Buffer) glDeleteBuffers(1, &m_Buffer);
+}
+
+void BonePalette::upload(const glm::mat4* matrices, size_t count, const std::vector<std::vector<unsigned int>>& palettes) {
+    if (palettes.empty()) return;
+    
+    size_t size = palettes.size() * m_RangeStride;
+    size_t vec4sPerRange = m_RangeStride / sizeof(glm::vec4);
+    m_Staging.resize(size / sizeof(glm::vec4));
+    
+    // gather every palette into its range, bones missing from the skeleton stay identity
+    for (size_t p = 0; p < palettes.size(); p++) {
+        glm::vec4* range = m_Staging.data() + p * vec4sPerRange;
+        size_t bones = std::min(palettes[p].size(), (size_t)m_MaxBones);
+        for (size_t i = 0; i < bones; i++) {
+            unsigned int bone = palettes[p][i];
+            glm::mat4 m = bone < count ? matrices[bone] : glm::mat4(1.0f);
+            if (m_Packed) {
+                // glm is column-major, row r of entry i goes to range[3 * i + r]
+                for (int r = 0; r < 3; r++) {
+                    range[3 * i + r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+                }
+            } else {
+                for (int c = 0; c < 4; c++) range[4 * i + c] = m[c];
+            }
+        }
+    }
+    
+    glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+    if (size > m_Capacity) {
+        glBufferData(GL_UNIFORM_BUFFER, size, m_Staging.data(), GL_DYNAMIC_DRAW);
+        m_Capacity = size;
+    } else {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, size, m_Staging.data());
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void BonePalette::bind(unsigned int palette) const {
+    if (m_Capacity == 0) return;
+    glBindBufferRange(GL_UNIFORM_BUFFER, BONE_PALETTE_BINDING, m_Buffer, palette * m_RangeStride, blockSize());
+}
+
+bool BonePalette::bindProgram(unsigned int programId) {
+    GLuint blockIndex = glGetUniformBlockIndex(programId, "BonePalette");
+    if (blockIndex == GL_INVALID_INDEX) return false;
+    glUniformBlockBinding(programId, blockIndex, BONE_PALETTE_BINDING);
+    return true;
+}
+
+std::string BonePalette::shaderDefines() const {
+    std::string defines = "#define MAX_BONES " + std::to_string(m_MaxBones) + "\n";
+    if (m_Packed) defines += "#define BONE_PALETTE_3X4\n";
+    return defines;
+}
@@ -0,0 +1,42 @@
+#include "header/bounds.h"
+#include <cmath>
+
+BoundingBox BoundingBox::transformed(const glm::mat4& matrix) const {
+    if (isEmpty()) return *this;
+    
+    // Center moves with the matrix, the extent along each axis is the sum of
+    // the absolute projections of the rotated half sizes
+    glm::vec3 c = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+    glm::vec3 e = extent();
+    glm::mat3 m(matrix);
+    glm::vec3 r = glm::abs(m[0]) * e.x + glm::abs(m[1]) * e.y + glm::abs(m[2]) * e.z;
+    
+    BoundingBox result;
+    result.min = c - r;
+    result.max = c + r;
+    return result;
+}
+
+Frustum::Frustum(const glm::mat4& clip) {
+    // Gribb/Hartmann: each plane is the fourth row plus or minus another row
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        m_Planes[i * 2] = rows[3] + rows[i];
+        m_Planes[i * 2 + 1] = rows[3] - rows[i];
+    }
+}
+
+bool Frustum::intersects(const BoundingBox& box) const {
+    if (box.isEmpty()) return false;
+    for (const glm::vec4& plane : m_Planes) {
+        // corner furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x,
+                         plane.y >= 0.0f ? box.max.y : box.min.y,
+                         plane.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) return false;
+    }
+    return true;
+}
@@ -6,7 +6,7 @@
 #include <iomanip>
 #include <glm/gtc/matrix_transform.hpp>
 
-CinematicDirector::CinematicDirector(camera_t& cam, glm::mat4& charModel, glm::mat4& cartModel, AnimatedModel* animModel)
+CinematicDirector::CinematicDirector(camera_t& cam, glm::mat4& charModel, glm::mat4& cartModel, AnimatedModelInstance* animModel)
     : m_Camera(cam)
     , m_CharacterModel(charModel)
     , m_CartModel(cartModel)
@@ -21,6 +21,7 @@ CinematicDirector::CinematicDirector(camera_t& cam, glm::mat4& charModel, glm::m
 {
     // initialize camera track and place characters at frame zero
     InitializeKeyframes();
+    ResolveBoneHandles();
     UpdateCharacterMovement(0.0f);
     UpdateCartMovement(0.0f);
     std::cout << "CinematicDirector: Constructor called, " << m_Keyframes.size() << " keyframes initialized" << std::endl;
@@ -353,27 +354,9 @@ void CinematicDirector::UpdateHeadRotation(float currentTime) {
     float headRotationEndTime = 6.0f;
     float headRotationDuration = 1.0f;
     
-    // bone name lists
-    static const std::vector<std::string> headBoneNames = {
-        "mixamorig:Head", "Head", "head",
-        "mixamorig:Neck", "Neck", "neck",
-        "mixamorig:Neck1", "Neck1", "neck1"
-    };
-    
-    static const std::vector<std::string> spineBoneNames = {
-        "mixamorig:Spine2", "Spine2", "spine2",
-        "mixamorig:Spine1", "Spine1", "spine1",
-        "mixamorig:Spine", "Spine", "spine",
-        "mixamorig:UpperChest", "UpperChest", "upperChest"
-    };
-    
     if (currentTime < headRotationStartTime) {
-        for (const auto& name : headBoneNames) {
-            m_AnimatedModel->clearBoneAdditionalRotation(name);
-        }
-        for (const auto& name : spineBoneNames) {
-            m_AnimatedModel->clearBoneAdditionalRotation(name);
-        }
+        m_AnimatedModel->clearBoneAdditionalRotation(m_HeadBone);
+        m_AnimatedModel->clearBoneAdditionalRotation(m_SpineBone);
         return;
     }
     
@@ -451,31 +434,14 @@ void CinematicDirector::UpdateHeadRotation(float currentTime) {
     
     glm::quat headRotation = glm::angleAxis(glm::radians(rotationAngle), glm::vec3(1.0f, 0.0f, 0.0f));
     
-    bool headRotationApplied = false;
-    for (const auto& boneName : headBoneNames) {
-        if (m_AnimatedModel->m_BoneInfoMap.find(boneName) != m_AnimatedModel->m_BoneInfoMap.end()) {
-            m_AnimatedModel->setBoneAdditionalRotation(boneName, headRotation);
-            headRotationApplied = true;
-            static float lastHeadPrintTime = -1.0f;
-            if (currentTime >= headRotationStartTime && currentTime <= headRotationEndTime) {
-                if (currentTime - lastHeadPrintTime > 0.2f) {
-                    std::cout << "Head rotation applied to bone: " << boneName << " (angle: " << rotationAngle << " degrees, progress: " << smoothProgress << ")" << std::endl;
-                    lastHeadPrintTime = currentTime;
-                }
-            }
-            break;
-        }
-    }
-    
-    if (!headRotationApplied && currentTime >= headRotationStartTime && currentTime <= headRotationEndTime) {
-        static bool warned = false;
-        if (!warned) {
-            std::cout << "WARNING: Could not find head bone! Tried: ";
-            for (const auto& name : headBoneNames) {
-                std::cout << name << " ";
+    if (m_HeadBone.isValid()) {
+        m_AnimatedModel->setBoneAdditionalRotation(m_HeadBone, headRotation);
+        static float lastHeadPrintTime = -1.0f;
+        if (currentTime >= headRotationStartTime && currentTime <= headRotationEndTime) {
+            if (currentTime - lastHeadPrintTime > 0.2f) {
+                std::cout << "Head rotation applied to bone: " << m_HeadBoneName << " (angle: " << rotationAngle << " degrees, progress: " << smoothProgress << ")" << std::endl;
+                lastHeadPrintTime = currentTime;
             }
-            std::cout << std::endl;
-            warned = true;
         }
     }
     
@@ -483,28 +449,53 @@ void CinematicDirector::UpdateHeadRotation(float currentTime) {
     float spineRotationAngle = rotationAngle * spineRotationFactor;
     glm::quat spineRotation = glm::angleAxis(glm::radians(spineRotationAngle), glm::vec3(1.0f, 0.0f, 0.0f));
     
-    bool spineRotationApplied = false;
-    for (const auto& boneName : spineBoneNames) {
-        if (m_AnimatedModel->m_BoneInfoMap.find(boneName) != m_AnimatedModel->m_BoneInfoMap.end()) {
-            m_AnimatedModel->setBoneAdditionalRotation(boneName, spineRotation);
-            spineRotationApplied = true;
-            if (currentTime - headRotationStartTime < 0.1f) {
-                std::cout << "Spine rotation applied to bone: " << boneName << " (angle: " << spineRotationAngle << " degrees)" << std::endl;
-            }
-            break;
+    if (m_SpineBone.isValid()) {
+        m_AnimatedModel->setBoneAdditionalRotation(m_SpineBone, spineRotation);
+        if (currentTime - headRotationStartTime < 0.1f) {
+            std::cout << "Spine rotation applied to bone: " << m_SpineBoneName << " (angle: " << spineRotationAngle << " degrees)" << std::endl;
         }
     }
+}
+
+void CinematicDirector::ResolveBoneHandles() {
+    if (!m_AnimatedModel) return;
+    
+    // bone name lists, the first one the model has is used
+    static const std::vector<std::string> headBoneNames = {
+        "mixamorig:Head", "Head", "head",
+        "mixamorig:Neck", "Neck", "neck",
+        "mixamorig:Neck1", "Neck1", "neck1"
+    };
     
-    bool rotationApplied = headRotationApplied || spineRotationApplied;
+    static const std::vector<std::string> spineBoneNames = {
+        "mixamorig:Spine2", "Spine2", "spine2",
+        "mixamorig:Spine1", "Spine1", "spine1",
+        "mixamorig:Spine", "Spine", "spine",
+        "mixamorig:UpperChest", "UpperChest", "upperChest"
+    };
+    
+    const auto& boneInfoMap = m_AnimatedModel->getAsset().m_BoneInfoMap;
+    auto resolve = [&](const std::vector<std::string>& names, BoneHandle& handle, std::string& resolvedName) {
+        for (const auto& name : names) {
+            if (boneInfoMap.find(name) == boneInfoMap.end()) continue;
+            handle = m_AnimatedModel->findBone(name);
+            if (handle.isValid()) {
+                resolvedName = name;
+                return;
+            }
+        }
+    };
+    resolve(headBoneNames, m_HeadBone, m_HeadBoneName);
+    resolve(spineBoneNames, m_SpineBone, m_SpineBoneName);
     
-    if (!rotationApplied && currentTime - headRotationStartTime < 0.5f) {
-        std::cout << "WARNING: Could not find head/neck bone. Tried: ";
+    if (!m_HeadBone.isValid()) {
+        std::cout << "WARNING: Could not find head bone! Tried: ";
         for (const auto& name : headBoneNames) {
             std::cout << name << " ";
         }
         std::cout << std::endl;
         std::cout << "Available bones: ";
-        for (const auto& pair : m_AnimatedModel->m_BoneInfoMap) {
+        for (const auto& pair : boneInfoMap) {
             if (pair.first.find("Head") != std::string::npos || 
                 pair.first.find("Neck") != std::string::npos ||
                 pair.first.find("head") != std::string::npos ||
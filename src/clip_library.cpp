@@ -0,0 +1,253 @@
+#include "header/clip_library.h"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+namespace {
+
+const char kMagic[8] = { 'I', 'C', 'G', 'C', 'L', 'I', 'P', 'S' };
+const uint32_t kVersion = 2;
+// keys of every clip start on their own page, playing one clip only faults in its pages
+const uint64_t kClipAlignment = 4096;
+// name length, duration, rate, frame count, source memory, key offset and size
+const size_t kMinTableEntrySize = 4 + 3 * 4 + 3 * 8;
+
+void writeKeys(std::ostream& out, const AnimationClip& clip) {
+    writeBinaryArray(out, clip.trackNodes);
+    writeBinaryArray(out, clip.translations);
+    writeBinaryArray(out, clip.rotations);
+    writeBinaryArray(out, clip.scales);
+    const CompressedClip& data = clip.compressed;
+    writeBinaryArray(out, data.firstKey);
+    writeBinaryArray(out, data.keyCounts);
+    writeBinaryArray(out, data.rangeMin);
+    writeBinaryArray(out, data.rangeExtent);
+    writeBinaryArray(out, data.keyFrames);
+    writeBinaryArray(out, data.keyData);
+}
+
+bool readKeys(BinaryReader& in, AnimationClip& clip) {
+    CompressedClip& data = clip.compressed;
+    return in.readArray(clip.trackNodes) && in.readArray(clip.translations) && in.readArray(clip.rotations) &&
+           in.readArray(clip.scales) && in.readArray(data.firstKey) && in.readArray(data.keyCounts) &&
+           in.readArray(data.rangeMin) && in.readArray(data.rangeExtent) && in.readArray(data.keyFrames) &&
+           in.readArray(data.keyData);
+}
+
+// Checks that the key arrays of a clip agree with each other and with the
+// skeleton, so sampling never indexes past them. Only the small per-track
+// tables are read, the bulk keys are left in the mapping.
+bool validKeys(BinaryReader in, unsigned int frameCount, size_t nodeCount) {
+    const int* trackNodes = nullptr;
+    const glm::vec3* translations = nullptr;
+    const glm::quat* rotations = nullptr;
+    const glm::vec3* scales = nullptr;
+    const uint32_t* firstKey = nullptr;
+    const uint16_t* keyCounts = nullptr;
+    const glm::vec3* rangeMin = nullptr;
+    const glm::vec3* rangeExtent = nullptr;
+    const uint16_t* keyFrames = nullptr;
+    const uint16_t* keyData = nullptr;
+    uint32_t trackCount = 0, translationCount = 0, rotationCount = 0, scaleCount = 0, firstKeyCount = 0,
+             keyCountCount = 0, rangeMinCount = 0, rangeExtentCount = 0, keyFrameCount = 0, keyDataCount = 0;
+    if (!in.viewArray(trackNodes, trackCount) || !in.viewArray(translations, translationCount) ||
+        !in.viewArray(rotations, rotationCount) || !in.viewArray(scales, scaleCount) ||
+        !in.viewArray(firstKey, firstKeyCount) || !in.viewArray(keyCounts, keyCountCount) ||
+        !in.viewArray(rangeMin, rangeMinCount) || !in.viewArray(rangeExtent, rangeExtentCount) ||
+        !in.viewArray(keyFrames, keyFrameCount) || !in.viewArray(keyData, keyDataCount)) {
+        return false;
+    }
+    if (frameCount < 2) return false;
+
+    // tracks are sorted by node, the LOD prefix search relies on it
+    for (uint32_t i = 0; i < trackCount; i++) {
+        int node = trackNodes[i];
+        if (node < 0 || (size_t)node >= nodeCount || (i > 0 && node <= trackNodes[i - 1])) return false;
+    }
+
+    // baked keys are dropped once a clip is compressed, otherwise they are all there
+    uint64_t bakedCount = (uint64_t)trackCount * frameCount;
+    bool baked = translationCount == bakedCount && rotationCount == bakedCount && scaleCount == bakedCount;
+    bool dropped = translationCount == 0 && rotationCount == 0 && scaleCount == 0;
+    if (!baked && !dropped) return false;
+    if (keyFrameCount == 0) return baked;
+
+    uint64_t slotCount = (uint64_t)trackCount * CLIP_CHANNEL_COUNT;
+    if (firstKeyCount != slotCount || keyCountCount != slotCount || rangeMinCount != slotCount ||
+        rangeExtentCount != slotCount || keyDataCount != (uint64_t)keyFrameCount * 3) {
+        return false;
+    }
+    for (uint32_t slot = 0; slot < slotCount; slot++) {
+        if (keyCounts[slot] < 1 || (uint64_t)firstKey[slot] + keyCounts[slot] > keyFrameCount) return false;
+    }
+    return true;
+}
+
+void pad(std::ostream& out) {
+    static const char zeros[kClipAlignment] = {};
+    uint64_t position = (uint64_t)out.tellp();
+    out.write(zeros, (kClipAlignment - position % kClipAlignment) % kClipAlignment);
+}
+
+} // namespace
+
+ClipLibrary::ClipLibrary(std::vector<AnimationClip>& clips) : m_Clips(clips) {}
+
+bool ClipLibrary::write(const std::string& path, const std::vector<AnimationClip>& clips, uint64_t sourceKey,
+                        float errorBound, size_t nodeCount) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "WARNING::CLIP_LIBRARY: Cannot write " << path << std::endl;
+        return false;
+    }
+    out.write(kMagic, sizeof(kMagic));
+    writeBinary(out, kVersion);
+    writeBinary(out, sourceKey);
+    writeBinary(out, errorBound);
+    writeBinary(out, (uint32_t)nodeCount);
+    writeBinary(out, (uint32_t)clips.size());
+
+    // the table is written twice, the second time with the key offsets
+    std::vector<Entry> entries(clips.size());
+    auto writeTable = [&]() {
+        for (size_t i = 0; i < clips.size(); i++) {
+            const AnimationClip& clip = clips[i];
+            writeBinaryString(out, clip.name);
+            writeBinary(out, clip.duration);
+            writeBinary(out, clip.sampleRate);
+            writeBinary(out, clip.frameCount);
+            writeBinary(out, (uint64_t)clip.sourceMemory);
+            writeBinary(out, entries[i].offset);
+            writeBinary(out, entries[i].size);
+        }
+    };
+    std::streampos tableStart = out.tellp();
+    writeTable();
+    for (size_t i = 0; i < clips.size(); i++) {
+        pad(out);
+        entries[i].offset = (uint64_t)out.tellp();
+        writeKeys(out, clips[i]);
+        entries[i].size = (uint64_t)out.tellp() - entries[i].offset;
+    }
+    out.seekp(tableStart);
+    writeTable();
+    return (bool)out;
+}
+
+bool ClipLibrary::open(const std::string& path, uint64_t sourceKey, float errorBound) {
+    if (!m_File.open(path)) return false;
+
+    BinaryReader in(m_File.data(), m_File.size());
+    char magic[sizeof(kMagic)];
+    uint32_t version = 0, storedNodeCount = 0, clipCount = 0;
+    uint64_t storedKey = 0;
+    float storedErrorBound = 0.0f;
+    for (char& c : magic) in.read(c);
+    in.read(version);
+    in.read(storedKey);
+    in.read(storedErrorBound);
+    in.read(storedNodeCount);
+    in.read(clipCount);
+    if (!in.ok() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion ||
+        storedKey != sourceKey || storedErrorBound != errorBound) {
+        m_File.close();
+        return false;
+    }
+    // every table entry takes at least kMinTableEntrySize bytes, a larger count is garbage
+    if (clipCount > in.remaining() / kMinTableEntrySize) {
+        m_File.close();
+        return false;
+    }
+
+    std::vector<AnimationClip> clips(clipCount);
+    std::vector<Entry> entries(clipCount);
+    for (uint32_t i = 0; i < clipCount; i++) {
+        AnimationClip& clip = clips[i];
+        uint64_t sourceMemory = 0;
+        in.readString(clip.name);
+        in.read(clip.duration);
+        in.read(clip.sampleRate);
+        in.read(clip.frameCount);
+        in.read(sourceMemory);
+        in.read(entries[i].offset);
+        in.read(entries[i].size);
+        clip.sourceMemory = (size_t)sourceMemory;
+        if (!in.ok() || entries[i].offset > m_File.size() || entries[i].size > m_File.size() - entries[i].offset ||
+            !validKeys(BinaryReader(m_File.data() + entries[i].offset, (size_t)entries[i].size), clip.frameCount,
+                       storedNodeCount)) {
+            m_File.close();
+            return false;
+        }
+    }
+    if (!in.ok()) {
+        m_File.close();
+        return false;
+    }
+
+    m_Clips = std::move(clips);
+    m_Entries = std::move(entries);
+    m_Slots.reset(new Slot[clipCount]);
+    m_NodeCount = storedNodeCount;
+    m_ResidentBytes = 0;
+    m_ResidentClips = 0;
+    return true;
+}
+
+const AnimationClip& ClipLibrary::acquire(unsigned int index) {
+    Slot& slot = m_Slots[index];
+    slot.lastUse.store(m_Frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    if (!slot.resident.load(std::memory_order_acquire)) {
+        pageIn(index);
+    }
+    return m_Clips[index];
+}
+
+void ClipLibrary::pageIn(unsigned int index) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Slot& slot = m_Slots[index];
+    if (slot.resident.load(std::memory_order_relaxed)) return;
+
+    // touching the mapping faults in the clip's pages, the rest of the file stays on disk
+    const Entry& entry = m_Entries[index];
+    AnimationClip& clip = m_Clips[index];
+    size_t metadataBytes = clip.memoryUsage();
+    BinaryReader in(m_File.data() + entry.offset, (size_t)entry.size);
+    if (!readKeys(in, clip)) {
+        std::cout << "ERROR::CLIP_LIBRARY: Damaged keys of clip " << clip.name << std::endl;
+        releaseKeys(clip);
+    }
+    slot.bytes = clip.memoryUsage() - metadataBytes;
+    m_ResidentBytes += slot.bytes;
+    m_ResidentClips++;
+    slot.resident.store(true, std::memory_order_release);
+}
+
+void ClipLibrary::releaseKeys(AnimationClip& clip) {
+    std::vector<int>().swap(clip.trackNodes);
+    std::vector<glm::vec3>().swap(clip.translations);
+    std::vector<glm::quat>().swap(clip.rotations);
+    std::vector<glm::vec3>().swap(clip.scales);
+    clip.compressed = CompressedClip();
+}
+
+void ClipLibrary::trim() {
+    unsigned int frame = m_Frame.load();
+    if (m_ResidentBytes > m_MemoryCap) {
+        std::vector<unsigned int> candidates;
+        for (unsigned int i = 0; i < m_Entries.size(); i++) {
+            if (m_Slots[i].resident && m_Slots[i].lastUse != frame) candidates.push_back(i);
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [&](unsigned int a, unsigned int b) { return m_Slots[a].lastUse < m_Slots[b].lastUse; });
+        for (unsigned int index : candidates) {
+            if (m_ResidentBytes <= m_MemoryCap) break;
+            Slot& slot = m_Slots[index];
+            releaseKeys(m_Clips[index]);
+            slot.resident = false;
+            m_ResidentBytes -= slot.bytes;
+            m_ResidentClips--;
+            slot.bytes = 0;
+        }
+    }
+    m_Frame = frame + 1;
+}
@@ -0,0 +1,257 @@
+#include "header/clip_sampling.h"
+#include "header/cpu_skinning.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CLIP_SAMPLING_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CLIP_SAMPLING_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CLIP_SAMPLING_TARGET(isa)
+#endif
+
+namespace {
+
+// -1 until the first use picks the best supported kernel
+std::atomic<int> g_Kernel(-1);
+
+// Blend factor correction for nlerp, a polynomial fit of slerp's angle over
+// the cosine d between the keys: t' = t + t(t - 0.5)(t - 1)k
+inline float correctFactor(float d, float t) {
+    float A = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+    float B = 0.848013f + d * (-1.06021f + d * 0.215638f);
+    float k = A * (t - 0.5f) * (t - 0.5f) + B;
+    return t + t * (t - 0.5f) * (t - 1.0f) * k;
+}
+
+void interpolateScalar(RotationBatch& b, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        float d = b.x0[i] * b.x1[i] + b.y0[i] * b.y1[i] + b.z0[i] * b.z1[i] + b.w0[i] * b.w1[i];
+        // shortest arc
+        float sign = d < 0.0f ? -1.0f : 1.0f;
+        float t = correctFactor(d * sign, b.t[i]);
+        float u = 1.0f - t;
+        t *= sign;
+        float x = u * b.x0[i] + t * b.x1[i];
+        float y = u * b.y0[i] + t * b.y1[i];
+        float z = u * b.z0[i] + t * b.z1[i];
+        float w = u * b.w0[i] + t * b.w1[i];
+        float inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+        b.x0[i] = x * inverseLength;
+        b.y0[i] = y * inverseLength;
+        b.z0[i] = z * inverseLength;
+        b.w0[i] = w * inverseLength;
+    }
+}
+
+#ifdef CLIP_SAMPLING_X86
+
+CLIP_SAMPLING_TARGET("sse2")
+size_t interpolateSSE(RotationBatch& b) {
+    const size_t count = b.size() & ~(size_t)3;
+    const __m128 half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f), three = _mm_set1_ps(3.0f);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 x0 = _mm_loadu_ps(&b.x0[i]), y0 = _mm_loadu_ps(&b.y0[i]), z0 = _mm_loadu_ps(&b.z0[i]), w0 = _mm_loadu_ps(&b.w0[i]);
+        __m128 x1 = _mm_loadu_ps(&b.x1[i]), y1 = _mm_loadu_ps(&b.y1[i]), z1 = _mm_loadu_ps(&b.z1[i]), w1 = _mm_loadu_ps(&b.w1[i]);
+        __m128 t = _mm_loadu_ps(&b.t[i]);
+
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, x1), _mm_mul_ps(y0, y1)),
+                              _mm_add_ps(_mm_mul_ps(z0, z1), _mm_mul_ps(w0, w1)));
+        __m128 sign = _mm_and_ps(d, signBit);
+        d = _mm_xor_ps(d, sign);
+
+        __m128 A = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(-3.2452f),
+                   _mm_mul_ps(d, _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)))))));
+        __m128 B = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(-1.06021f),
+                   _mm_mul_ps(d, _mm_set1_ps(0.215638f)))));
+        __m128 centered = _mm_sub_ps(t, half);
+        __m128 k = _mm_add_ps(_mm_mul_ps(A, _mm_mul_ps(centered, centered)), B);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(t, centered), _mm_mul_ps(_mm_sub_ps(t, one), k)));
+
+        __m128 u = _mm_sub_ps(one, t);
+        t = _mm_xor_ps(t, sign);
+        __m128 x = _mm_add_ps(_mm_mul_ps(u, x0), _mm_mul_ps(t, x1));
+        __m128 y = _mm_add_ps(_mm_mul_ps(u, y0), _mm_mul_ps(t, y1));
+        __m128 z = _mm_add_ps(_mm_mul_ps(u, z0), _mm_mul_ps(t, z1));
+        __m128 w = _mm_add_ps(_mm_mul_ps(u, w0), _mm_mul_ps(t, w1));
+
+        // rsqrt refined by one Newton step
+        __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                    _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+        __m128 r = _mm_rsqrt_ps(length2);
+        r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(three, _mm_mul_ps(length2, _mm_mul_ps(r, r))));
+        _mm_storeu_ps(&b.x0[i], _mm_mul_ps(x, r));
+        _mm_storeu_ps(&b.y0[i], _mm_mul_ps(y, r));
+        _mm_storeu_ps(&b.z0[i], _mm_mul_ps(z, r));
+        _mm_storeu_ps(&b.w0[i], _mm_mul_ps(w, r));
+    }
+    return count;
+}
+
+CLIP_SAMPLING_TARGET("avx2,fma")
+size_t interpolateAVX2(RotationBatch& b) {
+    const size_t count = b.size() & ~(size_t)7;
+    const __m256 half = _mm256_set1_ps(0.5f), one = _mm256_set1_ps(1.0f), three = _mm256_set1_ps(3.0f);
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    for (size_t i = 0; i < count; i += 8) {
+        __m256 x0 = _mm256_loadu_ps(&b.x0[i]), y0 = _mm256_loadu_ps(&b.y0[i]), z0 = _mm256_loadu_ps(&b.z0[i]), w0 = _mm256_loadu_ps(&b.w0[i]);
+        __m256 x1 = _mm256_loadu_ps(&b.x1[i]), y1 = _mm256_loadu_ps(&b.y1[i]), z1 = _mm256_loadu_ps(&b.z1[i]), w1 = _mm256_loadu_ps(&b.w1[i]);
+        __m256 t = _mm256_loadu_ps(&b.t[i]);
+
+        __m256 d = _mm256_fmadd_ps(x0, x1, _mm256_fmadd_ps(y0, y1, _mm256_fmadd_ps(z0, z1, _mm256_mul_ps(w0, w1))));
+        __m256 sign = _mm256_and_ps(d, signBit);
+        d = _mm256_xor_ps(d, sign);
+
+        __m256 A = _mm256_fmadd_ps(d, _mm256_fmadd_ps(d, _mm256_fnmadd_ps(d, _mm256_set1_ps(1.43519f), _mm256_set1_ps(3.55645f)),
+                                                      _mm256_set1_ps(-3.2452f)), _mm256_set1_ps(1.0904f));
+        __m256 B = _mm256_fmadd_ps(d, _mm256_fmadd_ps(d, _mm256_set1_ps(0.215638f), _mm256_set1_ps(-1.06021f)),
+                                   _mm256_set1_ps(0.848013f));
+        __m256 centered = _mm256_sub_ps(t, half);
+        __m256 k = _mm256_fmadd_ps(A, _mm256_mul_ps(centered, centered), B);
+        t = _mm256_fmadd_ps(_mm256_mul_ps(t, centered), _mm256_mul_ps(_mm256_sub_ps(t, one), k), t);
+
+        __m256 u = _mm256_sub_ps(one, t);
+        t = _mm256_xor_ps(t, sign);
+        __m256 x = _mm256_fmadd_ps(u, x0, _mm256_mul_ps(t, x1));
+        __m256 y = _mm256_fmadd_ps(u, y0, _mm256_mul_ps(t, y1));
+        __m256 z = _mm256_fmadd_ps(u, z0, _mm256_mul_ps(t, z1));
+        __m256 w = _mm256_fmadd_ps(u, w0, _mm256_mul_ps(t, w1));
+
+        __m256 length2 = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_fmadd_ps(z, z, _mm256_mul_ps(w, w))));
+        __m256 r = _mm256_rsqrt_ps(length2);
+        r = _mm256_mul_ps(_mm256_mul_ps(half, r), _mm256_fnmadd_ps(length2, _mm256_mul_ps(r, r), three));
+        _mm256_storeu_ps(&b.x0[i], _mm256_mul_ps(x, r));
+        _mm256_storeu_ps(&b.y0[i], _mm256_mul_ps(y, r));
+        _mm256_storeu_ps(&b.z0[i], _mm256_mul_ps(z, r));
+        _mm256_storeu_ps(&b.w0[i], _mm256_mul_ps(w, r));
+    }
+    return count;
+}
+
+#endif
+
+// Rotation angle between two unit quaternions. acos of their dot product loses
+// everything below ~0.05 degrees in float, the chord |a - b| = 2 sin(angle / 4) does not.
+float angleBetween(const glm::quat& a, const glm::quat& b) {
+    glm::quat shortest = glm::dot(a, b) < 0.0f ? -b : b;
+    float chord = glm::length(glm::vec4(a.x - shortest.x, a.y - shortest.y, a.z - shortest.z, a.w - shortest.w));
+    return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f));
+}
+
+} // namespace
+
+void RotationBatch::resize(size_t count) {
+    for (std::vector<float>* lane : { &x0, &y0, &z0, &w0, &x1, &y1, &z1, &w1, &t }) {
+        lane->resize(count);
+    }
+}
+
+void interpolateRotations(RotationBatch& batch, ClipSamplingKernel kernel) {
+    size_t done = 0;
+#ifdef CLIP_SAMPLING_X86
+    if (kernel == CLIP_SAMPLING_AVX2) done = interpolateAVX2(batch);
+    else if (kernel == CLIP_SAMPLING_SSE) done = interpolateSSE(batch);
+#endif
+    // the lanes past the last full register
+    interpolateScalar(batch, done, batch.size());
+}
+
+bool isClipSamplingKernelSupported(ClipSamplingKernel kernel) {
+    switch (kernel) {
+    case CLIP_SAMPLING_EXACT:
+    case CLIP_SAMPLING_SCALAR: return true;
+#ifdef CLIP_SAMPLING_X86
+    case CLIP_SAMPLING_SSE: return CpuSkinner::isKernelSupported(CPU_SKINNING_SSE);
+    case CLIP_SAMPLING_AVX2: return CpuSkinner::isKernelSupported(CPU_SKINNING_AVX2);
+#endif
+    default: return false;
+    }
+}
+
+const char* clipSamplingKernelName(ClipSamplingKernel kernel) {
+    switch (kernel) {
+    case CLIP_SAMPLING_SCALAR: return "nlerp scalar";
+    case CLIP_SAMPLING_SSE: return "nlerp SSE";
+    case CLIP_SAMPLING_AVX2: return "nlerp AVX2";
+    default: return "slerp";
+    }
+}
+
+void setClipSamplingKernel(ClipSamplingKernel kernel) {
+    while (kernel != CLIP_SAMPLING_EXACT && !isClipSamplingKernelSupported(kernel)) {
+        kernel = (ClipSamplingKernel)(kernel - 1);
+    }
+    g_Kernel = kernel;
+}
+
+ClipSamplingKernel getClipSamplingKernel() {
+    int kernel = g_Kernel.load();
+    if (kernel < 0) {
+        setClipSamplingKernel(CLIP_SAMPLING_AVX2);
+        kernel = g_Kernel.load();
+    }
+    return (ClipSamplingKernel)kernel;
+}
+
+void benchmarkClipSampling(const AnimationClip& clip, const Skeleton& skeleton) {
+    if (clip.trackCount() == 0 || clip.frameCount < 2) return;
+    ClipSamplingKernel savedKernel = getClipSamplingKernel();
+
+    const unsigned int sampleCount = clip.frameCount * 4;
+    std::vector<float> times(sampleCount);
+    for (unsigned int i = 0; i < sampleCount; i++) {
+        times[i] = clip.duration * i / sampleCount;
+    }
+    Pose pose;
+    pose.setToBindPose(skeleton);
+
+    // slerp reference for every sample
+    setClipSamplingKernel(CLIP_SAMPLING_EXACT);
+    std::vector<glm::quat> reference(sampleCount * clip.trackCount());
+    for (unsigned int i = 0; i < sampleCount; i++) {
+        sampleAnimationClip(clip, times[i], pose);
+        for (size_t track = 0; track < clip.trackCount(); track++) {
+            reference[i * clip.trackCount() + track] = pose.rotations[clip.trackNodes[track]];
+        }
+    }
+
+    std::cout << "Clip sampling benchmark (" << clip.name << ", " << clip.trackCount() << " tracks, "
+              << (clip.isCompressed() ? "compressed" : "baked") << "):" << std::endl;
+    for (int kernel = CLIP_SAMPLING_EXACT; kernel < CLIP_SAMPLING_KERNEL_COUNT; kernel++) {
+        if (!isClipSamplingKernelSupported((ClipSamplingKernel)kernel)) continue;
+        setClipSamplingKernel((ClipSamplingKernel)kernel);
+
+        float maxError = 0.0f;
+        for (unsigned int i = 0; i < sampleCount; i++) {
+            sampleAnimationClip(clip, times[i], pose);
+            for (size_t track = 0; track < clip.trackCount(); track++) {
+                maxError = std::max(maxError, angleBetween(pose.rotations[clip.trackNodes[track]],
+                                                           reference[i * clip.trackCount() + track]));
+            }
+        }
+
+        const int iterations = 50;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            for (unsigned int i = 0; i < sampleCount; i++) {
+                sampleAnimationClip(clip, times[i], pose);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        double tracksPerSecond = clip.trackCount() * (double)sampleCount * iterations / seconds;
+        std::cout << "  " << std::setw(12) << clipSamplingKernelName((ClipSamplingKernel)kernel) << ": "
+                  << std::fixed << std::setprecision(1) << tracksPerSecond / 1e6 << " M tracks/s, max angular error "
+                  << std::setprecision(5) << glm::degrees(maxError) << " deg" << std::defaultfloat << std::endl;
+    }
+
+    setClipSamplingKernel(savedKernel);
+}
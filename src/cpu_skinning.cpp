@@ -0,0 +1,334 @@
+#include "header/cpu_skinning.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_SKINNING_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang need the instruction set enabled per function to build the
+// AVX2 kernel without compiling the whole file for AVX2
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_SKINNING_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CPU_SKINNING_TARGET(isa)
+#endif
+
+namespace {
+
+typedef void (*LinearKernel)(const Vertex* vertices, size_t begin, size_t end, const glm::mat4* palette,
+                             size_t boneCount, glm::vec3* positions, glm::vec3* normals);
+
+// Vertices whose weights sum below this (no bone, or only pruned ones) keep
+// their bind position and normal instead of collapsing towards the origin
+const float kMinTotalWeight = 0.01f;
+
+inline glm::vec3 normalizeOr(const glm::vec3& v, const glm::vec3& fallback) {
+    float length2 = glm::dot(v, v);
+    return length2 > 1e-12f ? v / std::sqrt(length2) : fallback;
+}
+
+void skinLinearScalar(const Vertex* vertices, size_t begin, size_t end, const glm::mat4* palette,
+                      size_t boneCount, glm::vec3* positions, glm::vec3* normals) {
+    for (size_t i = begin; i < end; i++) {
+        const Vertex& vertex = vertices[i];
+        glm::mat4 blended(0.0f);
+        float totalWeight = 0.0f;
+        for (int j = 0; j < MAX_BONE_INFLUENCE; j++) {
+            int id = vertex.m_BoneIDs[j];
+            if (id < 0 || (size_t)id >= boneCount) continue;
+            blended += palette[id] * vertex.m_Weights[j];
+            totalWeight += vertex.m_Weights[j];
+        }
+        if (totalWeight < kMinTotalWeight) {
+            positions[i] = vertex.Position;
+            normals[i] = vertex.Normal;
+            continue;
+        }
+        positions[i] = glm::vec3(blended * glm::vec4(vertex.Position, 1.0f));
+        normals[i] = normalizeOr(glm::mat3(blended) * vertex.Normal, vertex.Normal);
+    }
+}
+
+#ifdef CPU_SKINNING_X86
+
+// One glm::mat4 column per register, the blended matrix stays in c0..c3
+CPU_SKINNING_TARGET("sse2")
+void skinLinearSSE(const Vertex* vertices, size_t begin, size_t end, const glm::mat4* palette,
+                   size_t boneCount, glm::vec3* positions, glm::vec3* normals) {
+    float out[4];
+    for (size_t i = begin; i < end; i++) {
+        const Vertex& vertex = vertices[i];
+        __m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+        float totalWeight = 0.0f;
+        for (int j = 0; j < MAX_BONE_INFLUENCE; j++) {
+            int id = vertex.m_BoneIDs[j];
+            if (id < 0 || (size_t)id >= boneCount) continue;
+            const float* m = glm::value_ptr(palette[id]);
+            __m128 w = _mm_set1_ps(vertex.m_Weights[j]);
+            c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(m)));
+            c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+            c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+            c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+            totalWeight += vertex.m_Weights[j];
+        }
+        if (totalWeight < kMinTotalWeight) {
+            positions[i] = vertex.Position;
+            normals[i] = vertex.Normal;
+            continue;
+        }
+        
+        const glm::vec3& p = vertex.Position;
+        __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p.x)), _mm_mul_ps(c1, _mm_set1_ps(p.y))),
+                                     _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p.z)), c3));
+        _mm_storeu_ps(out, position);
+        positions[i] = glm::vec3(out[0], out[1], out[2]);
+        
+        const glm::vec3& n = vertex.Normal;
+        __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(n.x)), _mm_mul_ps(c1, _mm_set1_ps(n.y))),
+                                   _mm_mul_ps(c2, _mm_set1_ps(n.z)));
+        _mm_storeu_ps(out, normal);
+        normals[i] = normalizeOr(glm::vec3(out[0], out[1], out[2]), n);
+    }
+}
+
+// Two matrix columns per 256-bit register: a bone is two loads and two FMAs
+CPU_SKINNING_TARGET("avx2,fma")
+void skinLinearAVX2(const Vertex* vertices, size_t begin, size_t end, const glm::mat4* palette,
+                    size_t boneCount, glm::vec3* positions, glm::vec3* normals) {
+    float out[4];
+    for (size_t i = begin; i < end; i++) {
+        const Vertex& vertex = vertices[i];
+        __m256 c01 = _mm256_setzero_ps(), c23 = _mm256_setzero_ps();
+        float totalWeight = 0.0f;
+        for (int j = 0; j < MAX_BONE_INFLUENCE; j++) {
+            int id = vertex.m_BoneIDs[j];
+            if (id < 0 || (size_t)id >= boneCount) continue;
+            const float* m = glm::value_ptr(palette[id]);
+            __m256 w = _mm256_set1_ps(vertex.m_Weights[j]);
+            c01 = _mm256_fmadd_ps(w, _mm256_loadu_ps(m), c01);
+            c23 = _mm256_fmadd_ps(w, _mm256_loadu_ps(m + 8), c23);
+            totalWeight += vertex.m_Weights[j];
+        }
+        if (totalWeight < kMinTotalWeight) {
+            positions[i] = vertex.Position;
+            normals[i] = vertex.Normal;
+            continue;
+        }
+        __m128 c0 = _mm256_castps256_ps128(c01), c1 = _mm256_extractf128_ps(c01, 1);
+        __m128 c2 = _mm256_castps256_ps128(c23), c3 = _mm256_extractf128_ps(c23, 1);
+        
+        const glm::vec3& p = vertex.Position;
+        __m128 position = _mm_fmadd_ps(c0, _mm_set1_ps(p.x),
+                          _mm_fmadd_ps(c1, _mm_set1_ps(p.y), _mm_fmadd_ps(c2, _mm_set1_ps(p.z), c3)));
+        _mm_storeu_ps(out, position);
+        positions[i] = glm::vec3(out[0], out[1], out[2]);
+        
+        const glm::vec3& n = vertex.Normal;
+        __m128 normal = _mm_fmadd_ps(c0, _mm_set1_ps(n.x),
+                        _mm_fmadd_ps(c1, _mm_set1_ps(n.y), _mm_mul_ps(c2, _mm_set1_ps(n.z))));
+        _mm_storeu_ps(out, normal);
+        normals[i] = normalizeOr(glm::vec3(out[0], out[1], out[2]), n);
+    }
+}
+
+#endif
+
+bool cpuHasAVX2() {
+#if defined(CPU_SKINNING_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(CPU_SKINNING_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    // the OS has to save the YMM registers as well
+    if (!osxsave || !fma || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+LinearKernel linearKernel(CpuSkinningKernel kernel) {
+#ifdef CPU_SKINNING_X86
+    if (kernel == CPU_SKINNING_AVX2) return skinLinearAVX2;
+    if (kernel == CPU_SKINNING_SSE) return skinLinearSSE;
+#endif
+    return skinLinearScalar;
+}
+
+} // namespace
+
+CpuSkinner::CpuSkinner(unsigned int threadCount) : m_Pool(threadCount) {
+    setKernel(CPU_SKINNING_AVX2);
+}
+
+bool CpuSkinner::isKernelSupported(CpuSkinningKernel kernel) {
+    switch (kernel) {
+    case CPU_SKINNING_SCALAR: return true;
+#ifdef CPU_SKINNING_X86
+    case CPU_SKINNING_SSE: return true;
+    case CPU_SKINNING_AVX2: {
+        static const bool supported = cpuHasAVX2();
+        return supported;
+    }
+#endif
+    default: return false;
+    }
+}
+
+const char* CpuSkinner::kernelName(CpuSkinningKernel kernel) {
+    switch (kernel) {
+    case CPU_SKINNING_SSE: return "SSE";
+    case CPU_SKINNING_AVX2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+void CpuSkinner::setKernel(CpuSkinningKernel kernel) {
+    while (kernel != CPU_SKINNING_SCALAR && !isKernelSupported(kernel)) {
+        kernel = (CpuSkinningKernel)(kernel - 1);
+    }
+    m_Kernel = kernel;
+}
+
+void CpuSkinner::updateDualQuats(const glm::mat4* palette, size_t boneCount) {
+    m_DualQuats.resize(boneCount);
+    for (size_t i = 0; i < boneCount; i++) {
+        const glm::mat4& m = palette[i];
+        glm::vec3 axes[3] = { glm::vec3(m[0]), glm::vec3(m[1]), glm::vec3(m[2]) };
+        glm::vec3 scale(glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2]));
+        for (int a = 0; a < 3; a++) {
+            if (scale[a] > 1e-8f) axes[a] /= scale[a];
+        }
+        glm::mat3 rotation(axes[0], axes[1], axes[2]);
+        // a mirrored bone keeps a proper rotation and a negative scale
+        if (glm::determinant(rotation) < 0.0f) {
+            scale.x = -scale.x;
+            rotation[0] = -rotation[0];
+        }
+        
+        DualQuat& dq = m_DualQuats[i];
+        dq.real = glm::normalize(glm::quat_cast(rotation));
+        glm::vec3 t(m[3]);
+        dq.dual = (glm::quat(0.0f, t.x, t.y, t.z) * dq.real) * 0.5f;
+        dq.scale = scale;
+    }
+}
+
+void CpuSkinner::skin(const std::vector<Vertex>& vertices, const glm::mat4* palette, size_t boneCount,
+                      std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) {
+    positions.resize(vertices.size());
+    normals.resize(vertices.size());
+    const size_t grain = 2048;
+    
+    if (m_Mode == SKINNING_LINEAR) {
+        LinearKernel kernel = linearKernel(m_Kernel);
+        m_Pool.parallelFor(vertices.size(), grain, [&](size_t begin, size_t end) {
+            kernel(vertices.data(), begin, end, palette, boneCount, positions.data(), normals.data());
+        });
+        return;
+    }
+    
+    // Dual quaternion blend of the rigid part, bone scales are blended linearly
+    // and applied in bone space first
+    updateDualQuats(palette, boneCount);
+    const DualQuat* dqs = m_DualQuats.data();
+    m_Pool.parallelFor(vertices.size(), grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Vertex& vertex = vertices[i];
+            glm::quat real(0.0f, 0.0f, 0.0f, 0.0f);
+            glm::quat dual(0.0f, 0.0f, 0.0f, 0.0f);
+            glm::vec3 scale(0.0f);
+            float totalWeight = 0.0f;
+            const glm::quat* pivot = nullptr;
+            for (int j = 0; j < MAX_BONE_INFLUENCE; j++) {
+                int id = vertex.m_BoneIDs[j];
+                if (id < 0 || (size_t)id >= boneCount) continue;
+                const DualQuat& dq = dqs[id];
+                float w = vertex.m_Weights[j];
+                if (!pivot) pivot = &dq.real;
+                // blend along the shortest arc
+                float signedWeight = glm::dot(*pivot, dq.real) < 0.0f ? -w : w;
+                real = real + dq.real * signedWeight;
+                dual = dual + dq.dual * signedWeight;
+                scale += dq.scale * w;
+                totalWeight += w;
+            }
+            float length = glm::length(real);
+            if (totalWeight < kMinTotalWeight || length < 1e-8f) {
+                positions[i] = vertex.Position;
+                normals[i] = vertex.Normal;
+                continue;
+            }
+            real = real * (1.0f / length);
+            dual = dual * (1.0f / length);
+            scale /= totalWeight;
+            
+            glm::quat translation = (dual * glm::conjugate(real)) * 2.0f;
+            positions[i] = real * (vertex.Position * scale) + glm::vec3(translation.x, translation.y, translation.z);
+            normals[i] = normalizeOr(real * (vertex.Normal / scale), vertex.Normal);
+        }
+    });
+}
+
+void CpuSkinner::benchmark(const std::vector<Vertex>& vertices, const glm::mat4* palette, size_t boneCount) {
+    if (vertices.empty()) return;
+    SkinningMode savedMode = m_Mode;
+    CpuSkinningKernel savedKernel = m_Kernel;
+    
+    CpuSkinner singleThread(1);
+    std::vector<glm::vec3> reference, referenceNormals, positions, normals;
+    singleThread.setKernel(CPU_SKINNING_SCALAR);
+    singleThread.skin(vertices, palette, boneCount, reference, referenceNormals);
+    
+    // enough iterations for roughly 20M vertices per run
+    const int iterations = std::max(3, (int)(20000000 / vertices.size()));
+    std::cout << "CPU skinning benchmark: " << vertices.size() << " vertices, " << boneCount << " bones, "
+              << iterations << " iterations" << std::endl;
+    
+    auto run = [&](CpuSkinner& skinner, CpuSkinningKernel kernel, SkinningMode mode) {
+        skinner.setKernel(kernel);
+        skinner.setMode(mode);
+        skinner.skin(vertices, palette, boneCount, positions, normals);   // warm up
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            skinner.skin(vertices, palette, boneCount, positions, normals);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        double verticesPerSecond = vertices.size() * (double)iterations / seconds;
+        
+        float maxError = 0.0f;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            maxError = std::max(maxError, glm::length(positions[i] - reference[i]));
+        }
+        std::cout << "  " << std::setw(6) << kernelName(skinner.getKernel()) << " "
+                  << (mode == SKINNING_LINEAR ? "linear" : "dual-quat") << ", " << skinner.getThreadCount()
+                  << " thread(s): " << std::fixed << std::setprecision(1) << verticesPerSecond / 1e6 << " M vertices/s, "
+                  << verticesPerSecond / 1e6 / skinner.getThreadCount() << " M vertices/s/core, max diff to scalar "
+                  << std::setprecision(5) << maxError << std::defaultfloat << std::endl;
+    };
+    
+    for (int kernel = CPU_SKINNING_SCALAR; kernel <= CPU_SKINNING_AVX2; kernel++) {
+        if (!isKernelSupported((CpuSkinningKernel)kernel)) continue;
+        run(singleThread, (CpuSkinningKernel)kernel, SKINNING_LINEAR);
+    }
+    run(singleThread, CPU_SKINNING_SCALAR, SKINNING_DUAL_QUATERNION);
+    if (getThreadCount() > 1) {
+        run(*this, CPU_SKINNING_AVX2, SKINNING_LINEAR);
+        run(*this, CPU_SKINNING_SCALAR, SKINNING_DUAL_QUATERNION);
+    }
+    
+    m_Mode = savedMode;
+    setKernel(savedKernel);
+}
@@ -0,0 +1,277 @@
+#include "header/crowd.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+CrowdSystem::CrowdSystem(std::shared_ptr<const AnimatedModelAsset> asset, float modelScale, float walkSpeed)
+    : m_Asset(std::move(asset)), m_ModelScale(modelScale), m_WalkSpeed(walkSpeed) {
+    // The asset's vertices and indices, followed by the per-instance attributes.
+    // vat.vert only reads the texture coordinates, positions and normals come
+    // from its texture.
+    glGenVertexArrays(1, &m_VAO);
+    glGenBuffers(1, &m_InstanceBuffer);
+    glBindVertexArray(m_VAO);
+    m_Asset->setVertexAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Asset->EBO);
+    
+    glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+    for (int column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(7 + column);
+        glVertexAttribPointer(7 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(7 + column, 1);
+    }
+    glEnableVertexAttribArray(11);
+    glVertexAttribPointer(11, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, time));
+    glVertexAttribDivisor(11, 1);
+    glEnableVertexAttribArray(12);
+    glVertexAttribPointer(12, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, tint));
+    glVertexAttribDivisor(12, 1);
+    
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // every instance gets all asset palettes back to back, like one frame of a
+    // BoneAnimationTexture
+    for (const auto& palette : m_Asset->m_Palettes) {
+        m_PaletteBases.push_back((int)m_EntryCount);
+        m_EntryCount += (unsigned int)palette.size();
+    }
+    glGenBuffers(1, &m_PaletteBuffer);
+    glGenTextures(1, &m_PaletteTexture);
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    m_MaxPaletteTexels = (size_t)std::max(maxTexels, 0);
+}
+
+CrowdSystem::~CrowdSystem() {
+    if (m_VAO) glDeleteVertexArrays(1, &m_VAO);
+    if (m_InstanceBuffer) glDeleteBuffers(1, &m_InstanceBuffer);
+    if (m_PaletteTexture) glDeleteTextures(1, &m_PaletteTexture);
+    if (m_PaletteBuffer) glDeleteBuffers(1, &m_PaletteBuffer);
+}
+
+void CrowdSystem::spawn(unsigned int count, const glm::vec2& areaMin, const glm::vec2& areaMax, unsigned int seed) {
+    m_AreaMin = glm::min(areaMin, areaMax);
+    m_AreaMax = glm::max(areaMin, areaMax);
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> posX(m_AreaMin.x, m_AreaMax.x);
+    std::uniform_real_distribution<float> posZ(m_AreaMin.y, m_AreaMax.y);
+    std::uniform_real_distribution<float> headingDist(0.0f, glm::two_pi<float>());
+    std::uniform_real_distribution<float> speedDist(0.85f, 1.15f);
+    std::uniform_real_distribution<float> offsetDist(0.0f, 10.0f);
+    std::uniform_int_distribution<unsigned int> clipDist(0, m_Asset->getClipCount() == 0 ? 0 : (unsigned int)m_Asset->getClipCount() - 1);
+    std::uniform_real_distribution<float> tintDist(0.6f, 1.0f);
+    
+    m_Walkers.clear();
+    m_Poses.clear();
+    for (unsigned int i = 0; i < count; i++) {
+        Walker walker;
+        walker.position = glm::vec3(posX(gen), 0.0f, posZ(gen));
+        walker.heading = headingDist(gen);
+        walker.speed = m_WalkSpeed * speedDist(gen);
+        walker.timeOffset = offsetDist(gen);
+        walker.clip = clipDist(gen);
+        walker.tint = glm::vec3(tintDist(gen), tintDist(gen), tintDist(gen));
+        m_Walkers.push_back(walker);
+    }
+    std::cout << "Crowd spawned: " << count << " walkers" << std::endl;
+}
+
+void CrowdSystem::update(float deltaTime) {
+    m_Time += deltaTime;
+    m_DeltaTime = deltaTime;
+    for (Walker& walker : m_Walkers) {
+        glm::vec3 direction(std::sin(walker.heading), 0.0f, std::cos(walker.heading));
+        walker.position += direction * walker.speed * deltaTime;
+        // mirror the heading on the border that was crossed
+        if (walker.position.x < m_AreaMin.x || walker.position.x > m_AreaMax.x) {
+            walker.heading = -walker.heading;
+            walker.position.x = glm::clamp(walker.position.x, m_AreaMin.x, m_AreaMax.x);
+        }
+        if (walker.position.z < m_AreaMin.y || walker.position.z > m_AreaMax.y) {
+            walker.heading = glm::pi<float>() - walker.heading;
+            walker.position.z = glm::clamp(walker.position.z, m_AreaMin.y, m_AreaMax.y);
+        }
+    }
+}
+
+glm::mat4 CrowdSystem::modelMatrix(const Walker& walker) const {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), walker.position);
+    model = glm::rotate(model, walker.heading, glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::scale(model, glm::vec3(m_ModelScale));
+}
+
+float CrowdSystem::clipTime(const Walker& walker) const {
+    // faster walkers play the clip faster so the feet do not slide
+    return m_Time * walker.speed / m_WalkSpeed + walker.timeOffset;
+}
+
+unsigned int CrowdSystem::uploadInstances(const glm::mat4& viewProjection, const BoundingBox& clipBounds) {
+    // Cull against the bounds of the whole clip, the pose is only known on the GPU
+    Frustum frustum(viewProjection);
+    m_Instances.clear();
+    for (const Walker& walker : m_Walkers) {
+        glm::mat4 model = modelMatrix(walker);
+        if (!frustum.intersects(clipBounds.transformed(model))) continue;
+        m_Instances.push_back({ model, clipTime(walker), walker.tint });
+    }
+    uploadInstanceBuffer();
+    return (unsigned int)m_Instances.size();
+}
+
+void CrowdSystem::uploadInstanceBuffer() {
+    if (m_Instances.empty()) return;
+    glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+    if (m_Instances.size() > m_InstanceCapacity) {
+        m_InstanceCapacity = m_Walkers.size();
+        glBufferData(GL_ARRAY_BUFFER, m_InstanceCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_Instances.size() * sizeof(InstanceData), m_Instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+unsigned int CrowdSystem::render(const glm::mat4& view, const glm::mat4& projection, const VertexAnimationTexture& vat) {
+    if (m_Walkers.empty() || vat.getFrameCount() == 0) return 0;
+    unsigned int count = uploadInstances(projection * view, vat.getBounds());
+    
+    glBindVertexArray(m_VAO);
+    m_Asset->drawSubmeshesInstanced(count);
+    glBindVertexArray(0);
+    return count;
+}
+
+unsigned int CrowdSystem::render(const glm::mat4& view, const glm::mat4& projection, const BoneAnimationTexture& bat,
+                                 shader_program_t& program) {
+    if (m_Walkers.empty() || bat.getFrameCount() == 0) return 0;
+    unsigned int count = uploadInstances(projection * view, bat.getBounds());
+    
+    glBindVertexArray(m_VAO);
+    m_Asset->drawSubmeshesInstanced(count, [&](unsigned int palette) { bat.setPalette(program, palette); });
+    glBindVertexArray(0);
+    return count;
+}
+
+void CrowdSystem::evaluatePoses(const glm::mat4& view, const glm::mat4& projection, WorkerPool& pool) {
+    if (m_Poses.size() != m_Walkers.size()) {
+        m_Poses.clear();
+        m_Poses.resize(m_Walkers.size());
+        for (size_t i = 0; i < m_Walkers.size(); i++) {
+            m_Poses[i].instance.reset(new AnimatedModelInstance(m_Asset));
+            m_Poses[i].instance->playClip(m_Walkers[i].clip);
+        }
+    }
+    m_Frame++;
+    
+    // Cull with the bounds of each walker's last pose and pick its skeleton LOD
+    // on this thread, only the evaluations and blends run on the pool
+    m_VisibleWalkers.clear();
+    m_Instances.clear();
+    size_t texelsPerInstance = (size_t)m_EntryCount * 3;
+    size_t maxInstances = m_MaxPaletteTexels > 0 && texelsPerInstance > 0 ? m_MaxPaletteTexels / texelsPerInstance : m_Walkers.size();
+    for (size_t i = 0; i < m_Walkers.size(); i++) {
+        const Walker& walker = m_Walkers[i];
+        WalkerPose& state = m_Poses[i];
+        glm::mat4 model = modelMatrix(walker);
+        if (!state.instance->isVisible(model, view, projection)) continue;
+        if (m_Instances.size() == maxInstances) {
+            if (!m_LimitWarned) {
+                std::cout << "WARNING::CROWD: palette texture buffer holds only " << maxInstances << " walkers" << std::endl;
+                m_LimitWarned = true;
+            }
+            break;
+        }
+        state.interval = 1u << state.instance->selectLod(model, view, projection);
+        // back in view: the palette is stale, blending away from it would show it
+        if (state.lastVisibleFrame + 1 != m_Frame) state.evaluated = false;
+        state.lastVisibleFrame = m_Frame;
+        m_VisibleWalkers.push_back(i);
+        m_Instances.push_back({ model, clipTime(walker), walker.tint });
+    }
+    
+    // Each walker is evaluated by one thread and writes its own slice of rows
+    m_PaletteRows.resize(m_Instances.size() * texelsPerInstance);
+    pool.parallelFor(m_VisibleWalkers.size(), 16, [&](size_t begin, size_t end) {
+        const glm::mat4 identity(1.0f);
+        for (size_t k = begin; k < end; k++) {
+            size_t index = m_VisibleWalkers[k];
+            const Walker& walker = m_Walkers[index];
+            poseWalker(m_Poses[index], index, m_Instances[k].time, m_DeltaTime * walker.speed / m_WalkSpeed);
+            const std::vector<glm::mat4>& matrices = m_Poses[index].instance->m_FinalBoneMatrices;
+            glm::vec4* out = m_PaletteRows.data() + k * texelsPerInstance;
+            for (const auto& palette : m_Asset->m_Palettes) {
+                for (unsigned int bone : palette) {
+                    glm::mat4 rows = glm::transpose(bone < matrices.size() ? matrices[bone] : identity);
+                    out[0] = rows[0];
+                    out[1] = rows[1];
+                    out[2] = rows[2];
+                    out += 3;
+                }
+            }
+        }
+    });
+}
+
+void CrowdSystem::poseWalker(WalkerPose& state, size_t index, float time, float timeStep) {
+    AnimatedModelInstance& pose = *state.instance;
+    bool due = !state.evaluated || m_Frame - state.lastUpdateFrame >= state.interval;
+    if (!due) {
+        if (!state.blending) return;
+        float span = state.toTime - state.fromTime;
+        float t = (span != 0.0f) ? (time - state.fromTime) / span : 1.0f;
+        pose.blendPalettes(state.fromPalette, state.toPalette, std::min(std::max(t, 0.0f), 1.0f));
+        return;
+    }
+    
+    if (state.interval <= 1 || !state.evaluated) {
+        pose.updateAnimation(time);
+        state.blending = false;
+    } else {
+        // Evaluate where the walker will be at its next evaluation and blend
+        // towards it from the palette shown now
+        AnimatedModelInstance::decomposePalette(pose.m_FinalBoneMatrices, state.fromPalette);
+        state.fromTime = time;
+        state.toTime = time + timeStep * state.interval;
+        pose.updateAnimation(state.toTime);
+        AnimatedModelInstance::decomposePalette(pose.m_FinalBoneMatrices, state.toPalette);
+        pose.blendPalettes(state.fromPalette, state.toPalette, 0.0f);
+        state.blending = true;
+    }
+    // walkers sharing an interval are evaluated on different frames
+    state.lastUpdateFrame = state.evaluated ? m_Frame : m_Frame - index % state.interval;
+    state.evaluated = true;
+}
+
+unsigned int CrowdSystem::render(shader_program_t& program, unsigned int textureUnit) {
+    // nothing evaluated for the instances of this frame
+    if (m_Instances.empty() || m_PaletteRows.size() != m_Instances.size() * m_EntryCount * 3) return 0;
+    uploadInstanceBuffer();
+    
+    size_t bytes = m_PaletteRows.size() * sizeof(glm::vec4);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_PaletteBuffer);
+    if (bytes > m_PaletteCapacity) {
+        m_PaletteCapacity = std::max(bytes, m_Walkers.size() * m_EntryCount * 3 * sizeof(glm::vec4));
+        if (m_MaxPaletteTexels > 0) m_PaletteCapacity = std::min(m_PaletteCapacity, m_MaxPaletteTexels * sizeof(glm::vec4));
+        glBufferData(GL_TEXTURE_BUFFER, m_PaletteCapacity, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, m_PaletteTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_PaletteBuffer);
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, m_PaletteRows.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_PaletteTexture);
+    program.set_uniform_value("instancePalettes", (int)textureUnit);
+    program.set_uniform_value("paletteEntryCount", (int)m_EntryCount);
+    
+    unsigned int count = (unsigned int)m_Instances.size();
+    glBindVertexArray(m_VAO);
+    m_Asset->drawSubmeshesInstanced(count, [&](unsigned int palette) {
+        program.set_uniform_value("paletteBase", palette < m_PaletteBases.size() ? m_PaletteBases[palette] : 0);
+    });
+    glBindVertexArray(0);
+    return count;
+}
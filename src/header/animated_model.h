@@ -1,82 +1,138 @@
 #ifndef ANIMATED_MODEL_H
 #define ANIMATED_MODEL_H
 
-#include <glad/glad.h>
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
-#include <glm/gtx/quaternion.hpp>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-#include <assimp/config.h>
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include "animated_model_asset.h"
 
-#define MAX_BONE_INFLUENCE 4
-
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-    glm::vec2 TexCoords;
-    int m_BoneIDs[MAX_BONE_INFLUENCE];
-    float m_Weights[MAX_BONE_INFLUENCE];
+// A clip currently playing on the model. Weights fade linearly over time so
+// the state only depends on the time passed to updateAnimation.
+struct ClipLayer {
+    int clip;
+    float timeOffset;       // clip time = animation time + timeOffset
+    float startWeight;
+    float targetWeight;
+    float fadeStart;        // animation time the fade started at
+    float fadeDuration;
+    
+    float weightAt(float time) const;
 };
 
-struct BoneInfo {
-    int id;
-    glm::mat4 offset;
+// Instrumentation counters for the pose memoization
+struct AnimationStats {
+    unsigned long evaluatedUpdates = 0;
+    unsigned long skippedUpdates = 0;       // inputs unchanged, previous palette reused
+    unsigned long paletteUploads = 0;
+    unsigned long skippedPaletteUploads = 0;
 };
 
-class AnimatedModel {
+// Per-character playback state on top of a shared AnimatedModelAsset: clip
+// layers, bone overrides, pose buffers and the bone palette. Creating one does
+// no file or GPU work.
+class AnimatedModelInstance {
 public:
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    unsigned int VAO, VBO, EBO;
-    unsigned int texture;
-    
-    // bone stuff
-    std::map<std::string, BoneInfo> m_BoneInfoMap;
-    int m_BoneCounter = 0;
+    explicit AnimatedModelInstance(std::shared_ptr<const AnimatedModelAsset> asset);
     
-    // animation
-    const aiScene* m_scene;
-    Assimp::Importer m_Importer;
-    
-    AnimatedModel(const std::string& path);
-    void loadModel(const std::string& path);
-    void processNode(aiNode* node, const aiScene* scene);
-    void processMesh(aiMesh* mesh, const aiScene* scene);
-    void loadTexture(const std::string& filepath);
-    void setupMesh();
-    void render();
+    const AnimatedModelAsset& getAsset() const { return *m_Asset; }
+    // palette must hold this instance's matrices, uploaded with the asset's m_Palettes
+    void render(const BonePalette& palette);
     
     // animation functions
+    void setAnimation(unsigned int animationIndex);
     void updateAnimation(float timeInSeconds);
-    void calculateBoneTransform(const aiNode* node, glm::mat4 parentTransform, float animationTime);
-    glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from);
-    glm::vec3 aiVector3DToGlm(const aiVector3D& vec);
-    glm::quat aiQuaternionToGlm(const aiQuaternion& pOrientation);
     
-    // bone functions
-    void setVertexBoneDataToDefault(Vertex& vertex);
-    void setVertexBoneData(Vertex& vertex, int boneID, float weight);
-    void extractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const aiScene* scene);
+    // Multi-clip playback: every playing clip is sampled into its own local pose
+    // and the poses are blended before a single hierarchy pass
+    void playClip(unsigned int clipIndex, float weight = 1.0f, float fadeDuration = 0.0f, float timeOffset = 0.0f);
+    void stopClip(unsigned int clipIndex, float fadeDuration = 0.0f);
+    void crossfadeTo(unsigned int clipIndex, float fadeDuration, float timeOffset = 0.0f);
+    int findClip(const std::string& name) const { return m_Asset->findClip(name); }
+    const std::vector<ClipLayer>& getClipLayers() const { return m_Layers; }
     
     std::vector<glm::mat4> m_FinalBoneMatrices;
     
-    // Additional bone rotation control (for cinematic purposes)
+    // Bumped every time m_FinalBoneMatrices is recomputed
+    unsigned int getPaletteVersion() const { return m_PaletteVersion; }
+    // True if the palette changed since it was last uploaded to this shader program;
+    // the caller is expected to upload it when this returns true
+    bool shouldUploadPalette(unsigned int programId);
+    const AnimationStats& getStats() const { return m_Stats; }
+    // Splits every bone matrix of palette into translation, rotation and scale,
+    // one Pose entry per bone, as input for blendPalettes
+    static void decomposePalette(const std::vector<glm::mat4>& palette, Pose& result);
+    // Sets the palette between two decomposed palettes (t = 0 gives from), for
+    // characters evaluated every few frames (see AnimationScheduler); the next
+    // updateAnimation evaluates again. Rotations are nlerp-ed so limbs keep their
+    // length, the bounds are recomputed from the blended palette.
+    void blendPalettes(const Pose& from, const Pose& to, float t);
+    
+    // Model-space bounds of the last evaluated pose, from the asset's per-bone
+    // boxes and the bone matrices; empty before the first update
+    const BoundingBox& getBounds() const { return m_Bounds; }
+    // Frustum test of getBounds() (the bind-pose bounds before the first update)
+    bool isVisible(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const;
+    
+    // Skeleton LOD, picked from the screen height the pose bounds cover.
+    // Returns the selected level.
+    unsigned int selectLod(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection);
+    void setLod(unsigned int lod);
+    unsigned int getLod() const { return m_Lod; }
+    // Bytes owned by this instance, the shared asset is not counted
+    size_t memoryUsage() const;
+    
+    // Additional bone rotation control (for cinematic purposes). Resolve the
+    // handle once with findBone(), the name overloads look it up on every call.
+    BoneHandle findBone(const std::string& boneName) const;
+    void setBoneAdditionalRotation(BoneHandle bone, const glm::quat& additionalRotation);
+    void clearBoneAdditionalRotation(BoneHandle bone);
     void setBoneAdditionalRotation(const std::string& boneName, const glm::quat& additionalRotation);
     void clearBoneAdditionalRotation(const std::string& boneName);
     void clearAllBoneAdditionalRotations();
     
 private:
+    std::shared_ptr<const AnimatedModelAsset> m_Asset;
     float m_AnimationTime = 0.0f;
-    aiAnimation* m_CurrentAnimation = nullptr;
     
-    // Map to store additional rotations for specific bones (e.g., head rotation)
-    std::map<std::string, glm::quat> m_AdditionalBoneRotations;
+    std::vector<ClipLayer> m_Layers;
+    ClipLayer* findLayer(int clipIndex);
+    void fadeLayer(ClipLayer& layer, float targetWeight, float fadeDuration);
+    
+    // Per-frame pose buffers (local TRS, global and final matrices)
+    Pose m_Pose;
+    std::vector<Pose> m_LayerPoses;
+    std::vector<float> m_LayerWeights;
+    
+    // Inputs of the last evaluation: skip the update when nothing changed
+    struct LayerSample {
+        int clip;
+        float clipTime;
+        float weight;
+        bool operator==(const LayerSample& other) const {
+            return clip == other.clip && clipTime == other.clipTime && weight == other.weight;
+        }
+    };
+    std::vector<LayerSample> m_Samples;
+    std::vector<LayerSample> m_LastSamples;
+    unsigned int m_OverrideVersion = 0;
+    unsigned int m_LastOverrideVersion = 0;
+    unsigned int m_Lod = 0;
+    unsigned int m_LastLod = 0;
+    unsigned int m_PaletteVersion = 0;
+    bool m_HasEvaluated = false;
+    std::map<unsigned int, unsigned int> m_UploadedPaletteVersions;
+    AnimationStats m_Stats;
+    std::vector<glm::mat4> m_GlobalTransforms;
+    BoundingBox m_Bounds;
+    void updateBounds();
+    
+    // Additional rotations for specific nodes (e.g., head rotation), applied to
+    // the local pose before composition. Only a few nodes, searched linearly.
+    std::vector<int> m_OverrideNodes;
+    std::vector<glm::quat> m_OverrideRotations;
 };
 
 #endif
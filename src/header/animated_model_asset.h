@@ -0,0 +1,254 @@
+#ifndef ANIMATED_MODEL_ASSET_H
+#define ANIMATED_MODEL_ASSET_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <assimp/config.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include "skeleton.h"
+#include "animation_clip.h"
+#include "clip_library.h"
+#include "mesh_cache.h"
+#include "bone_palette.h"
+#include "bounds.h"
+
+// Influences a CPU vertex can hold; the GPU layout keeps 1, 2, 4 or 8 of them
+#define MAX_BONE_INFLUENCE 8
+// Influences below this fraction of the vertex total are dropped at import
+#define MIN_BONE_WEIGHT 0.01f
+// Bones one submesh palette may hold: GPU bone ids are uint8, and 256 mat4
+// fill the 16 KB minimum GL_MAX_UNIFORM_BLOCK_SIZE
+#define MAX_PALETTE_BONES 256
+// Palette entry uploaded as identity, used by vertices without bones
+#define PALETTE_IDENTITY_BONE 0xFFFFFFFFu
+
+// Influences are sorted by weight, normalized to sum 1, unused slots are -1
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    int m_BoneIDs[MAX_BONE_INFLUENCE];
+    float m_Weights[MAX_BONE_INFLUENCE];
+};
+
+// GPU side vertex layout built from Vertex by setupMesh(), specialized for the
+// influence count so the shaders read exactly that many. Bone ids index the
+// palette of the vertex's submesh. Unused influence slots have bone 0 and
+// weight 0 instead of the -1 sentinel.
+struct PackedVertexAttributes {
+    int16_t normal[2];                      // octahedral, snorm16
+    uint16_t texCoords[2];                  // half float
+};
+
+template <int Influences>
+struct PackedBoneInfluences {
+    uint8_t boneIDs[Influences];
+    uint8_t weights[Influences];            // unorm8, sum to 255
+};
+
+// a single bone has weight 1, padded to keep the stride a multiple of 4
+template <>
+struct PackedBoneInfluences<1> {
+    uint8_t boneIDs[1];
+    uint8_t padding[3];
+};
+
+struct FloatPosition {
+    float value[3];
+};
+
+struct QuantizedPosition {
+    uint16_t value[4];                      // unorm16 inside the mesh bounds, w unused
+};
+
+// 24/24/28/36 bytes for 1/2/4/8 influences, 4 less with QuantizedPosition; Vertex is 96
+template <typename Position, int Influences>
+struct PackedVertex {
+    Position position;
+    PackedVertexAttributes attributes;
+    PackedBoneInfluences<Influences> influences;
+};
+
+// One mesh of the FBX file inside the shared vertex and index buffers. Its
+// indices are mesh-local and drawn with baseVertex added. Meshes referencing
+// more than MAX_PALETTE_BONES bones are split into several submeshes.
+struct Submesh {
+    std::string name;
+    unsigned int baseVertex;
+    unsigned int vertexCount;
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    unsigned int materialIndex;
+    unsigned int palette = 0;               // index into AnimatedModelAsset::m_Palettes
+};
+
+// Everything loaded from the FBX file: mesh, GL buffers, texture, skeleton and
+// baked clips. Mesh, skeleton and clip metadata are not modified after loading;
+// only the clip keys are, paged in by acquireClip() and dropped again by
+// trimClips(), both synchronized by the clip library. Any number of
+// AnimatedModelInstance objects can share one through a shared_ptr<const>.
+// Mesh and skeleton are kept in a mesh cache next to the model file
+// ("<path>.meshcache") and the clips in a clip library, so a warm start does
+// not run Assimp at all.
+class AnimatedModelAsset {
+public:
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<Submesh> m_Submeshes;
+    // Skeleton bone ids of every submesh palette, submeshes with the same bones
+    // share one. CPU vertices keep skeleton bone ids, GPU vertices palette indices.
+    std::vector<std::vector<unsigned int>> m_Palettes;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    unsigned int texture = 0;
+    
+    // bone stuff
+    std::map<std::string, BoneInfo> m_BoneInfoMap;
+    int m_BoneCounter = 0;
+    Skeleton m_Skeleton;
+    // Bind-space box of the vertices each bone moves, by bone id (empty for bones
+    // without vertices); vertices without bones go to m_UnskinnedBounds
+    std::vector<BoundingBox> m_BoneBounds;
+    BoundingBox m_UnskinnedBounds;
+    
+    // clipErrorBound: allowed clip compression error at the bone tips, in model
+    // units (Mixamo rigs are in centimetres); 0 keeps the uncompressed baked clips.
+    // quantizePositions stores GPU positions as unorm16 inside the mesh bounds,
+    // the shaders then need QUANTIZED_POSITIONS and the positionOffset/Scale uniforms.
+    // boneInfluences (1, 2, 4 or 8) is the most bones a vertex keeps, the
+    // shaders are compiled for it through shaderDefines()
+    AnimatedModelAsset(const std::string& path, float clipErrorBound = 0.01f, bool quantizePositions = false,
+                       int boneInfluences = 4);
+    ~AnimatedModelAsset();
+    // owns GL objects
+    AnimatedModelAsset(const AnimatedModelAsset&) = delete;
+    AnimatedModelAsset& operator=(const AnimatedModelAsset&) = delete;
+    
+    void loadModel(const std::string& path);
+    void processNode(aiNode* node, const aiScene* scene);
+    void processMesh(aiMesh* mesh, const aiScene* scene);
+    // call before handing the asset to instances
+    void loadTexture(const std::string& filepath);
+    // Splits meshes over MAX_PALETTE_BONES and builds m_Palettes, before setupMesh()
+    void buildPalettes();
+    // packVertices() then uploadMesh()
+    void setupMesh();
+    // Computes the bounds and builds the GPU vertex buffer contents
+    void packVertices(std::vector<uint8_t>& packed);
+    // Creates the VAO and buffers from packed vertices and builds the draw table
+    void uploadMesh(const void* packedVertices);
+    // The palette has to hold this asset's m_Palettes
+    void draw(const BonePalette& palette) const;
+    // Draws every submesh with the bound VAO, binding each submesh's palette range
+    // and issuing one glMultiDrawElementsBaseVertex per palette
+    void drawSubmeshes(const BonePalette& palette) const;
+    // Same without palettes, for VAOs holding already skinned vertices
+    void drawSubmeshes() const;
+    // One glDrawElementsInstancedBaseVertex per submesh, for the animation
+    // textures; selectPalette is called before the submeshes of each palette
+    void drawSubmeshesInstanced(unsigned int instanceCount,
+                                const std::function<void(unsigned int palette)>& selectPalette = nullptr) const;
+    // Largest palette, the MAX_BONES the shaders need
+    unsigned int maxPaletteSize() const;
+    // Sets up the packed vertex layout (locations 0 to 6) on the bound VAO; the
+    // shaders declare the matching inputs once, in shaders/skinning_common.glsl
+    void setVertexAttributes() const;
+    // Points a vertex attribute of the bound VAO at the packed texture coordinates
+    void setTexCoordAttribute(unsigned int location) const;
+    
+    // bind-pose mesh bounds
+    glm::vec3 getBoundsMin() const { return m_BoundsMin; }
+    glm::vec3 getBoundsMax() const { return m_BoundsMax; }
+    bool hasQuantizedPositions() const { return m_QuantizePositions; }
+    int getBoneInfluences() const { return m_BoneInfluences; }
+    // position = positionOffset + quantized * positionScale
+    glm::vec3 getPositionOffset() const { return m_PositionOffset; }
+    glm::vec3 getPositionScale() const { return m_PositionScale; }
+    // Defines the animated shaders need for this vertex layout
+    std::string shaderDefines() const;
+    size_t vertexBufferSize() const { return vertices.size() * m_VertexStride; }
+    
+    size_t getClipCount() const { return m_Clips.size(); }
+    const std::string& getClipName(unsigned int index) const { return m_Clips[index].name; }
+    float getClipDuration(unsigned int index) const { return m_Clips[index].duration; }
+    int findClip(const std::string& name) const;
+    // The clip with its keys, paged in from the clip library if they are not
+    // resident. Safe on worker threads.
+    const AnimationClip& acquireClip(unsigned int index) const;
+    // Evicts library clips over the memory cap, once per frame outside of sampling
+    void trimClips();
+    void setClipMemoryCap(size_t bytes);
+    // null if the library could not be written, all clips are resident then
+    const ClipLibrary* getClipLibrary() const { return m_ClipLibrary.get(); }
+    // CPU side bytes (mesh copy and clips)
+    size_t memoryUsage() const;
+    glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from);
+    
+    // bone functions
+    void setVertexBoneDataToDefault(Vertex& vertex);
+    void setVertexBoneData(Vertex& vertex, int boneID, float weight);
+    // Prunes the influences of a vertex to the configured count and renormalizes them
+    void limitBoneInfluences(Vertex& vertex);
+    void extractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const aiScene* scene, unsigned int baseVertex);
+    
+private:
+    // Runs the Assimp import, null on failure
+    const aiScene* importScene(Assimp::Importer& importer, const std::string& path, unsigned int importFlags,
+                               bool readAnimations);
+    // Mesh cache payload: everything from processNode() to m_Skeleton.build()
+    // plus the packed vertices, which are uploaded straight from the mapping
+    bool loadMeshCache(const std::string& path, uint64_t key);
+    bool saveMeshCache(const std::string& path, uint64_t key, const std::vector<uint8_t>& packedVertices) const;
+    // Bakes and compresses the animations of the scene into m_Clips
+    void bakeClips(const aiScene* scene);
+    // Imports only the animations of the model file
+    void importClips(const std::string& path);
+    
+    template <int Influences>
+    void packVertices(const std::vector<std::vector<int>>& localBoneIds, const std::vector<unsigned int>& vertexPalette,
+                      std::vector<uint8_t>& packed);
+    template <typename Position, int Influences>
+    void packVertices(const std::vector<std::vector<int>>& localBoneIds, const std::vector<unsigned int>& vertexPalette,
+                      std::vector<uint8_t>& packed);
+    
+    // animation clips baked at import, the aiScene is not kept after loading.
+    // They are stored in a clip library next to the model file ("<path>.clips")
+    // and only their names and lengths stay resident until acquireClip().
+    std::vector<AnimationClip> m_Clips;
+    float m_ClipErrorBound = 0.01f;
+    std::unique_ptr<ClipLibrary> m_ClipLibrary;
+    bool m_QuantizePositions = false;
+    int m_BoneInfluences = 4;
+    glm::vec3 m_BoundsMin = glm::vec3(0.0f);
+    glm::vec3 m_BoundsMax = glm::vec3(0.0f);
+    glm::vec3 m_PositionOffset = glm::vec3(0.0f);
+    glm::vec3 m_PositionScale = glm::vec3(1.0f);
+    size_t m_VertexStride = sizeof(Vertex);
+    size_t m_TexCoordOffset = 0;
+    size_t m_NormalOffset = 0;
+    size_t m_InfluencesOffset = 0;
+    
+    // multi-draw arguments built by setupMesh(), ordered by palette then material
+    std::vector<GLsizei> m_DrawCounts;
+    std::vector<const void*> m_DrawOffsets;
+    std::vector<GLint> m_DrawBaseVertices;
+    // consecutive draws sharing a palette
+    struct PaletteDraws {
+        unsigned int palette;
+        size_t first;
+        size_t count;
+    };
+    std::vector<PaletteDraws> m_PaletteDraws;
+};
+
+#endif
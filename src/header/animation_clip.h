@@ -0,0 +1,75 @@
+#ifndef ANIMATION_CLIP_H
+#define ANIMATION_CLIP_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <assimp/scene.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "skeleton.h"
+
+enum ClipChannel {
+    CLIP_TRANSLATION = 0,
+    CLIP_ROTATION = 1,
+    CLIP_SCALE = 2,
+    CLIP_CHANNEL_COUNT = 3
+};
+
+// Compressed key data of a clip. Every (track, channel) keeps only the frames
+// needed to stay within the error bound, each key packed into three 16-bit
+// words: smallest-three quaternions for rotations and values quantized to the
+// channel's [min, min + extent] range for translations and scales.
+struct CompressedClip {
+    std::vector<uint32_t> firstKey;     // per (track * 3 + channel)
+    std::vector<uint16_t> keyCounts;    // per (track * 3 + channel), >= 1
+    std::vector<glm::vec3> rangeMin;    // per (track * 3 + channel), unused for rotations
+    std::vector<glm::vec3> rangeExtent;
+    std::vector<uint16_t> keyFrames;    // baked frame index of every key
+    std::vector<uint16_t> keyData;      // 3 words per key
+
+    bool empty() const { return keyFrames.empty(); }
+    size_t memoryUsage() const;
+};
+
+// Animation resampled at a fixed rate when the model is imported.
+// Tracks are stored bone-major with one array per channel: the samples of
+// track t live at [t * frameCount, (t + 1) * frameCount). Sampling is a
+// direct index computation and needs nothing from Assimp. Tracks are sorted
+// by node, so the tracks of a skeleton LOD level are a prefix.
+struct AnimationClip {
+    std::string name;
+    float duration = 0.0f;          // seconds
+    float sampleRate = 30.0f;       // frames per second
+    unsigned int frameCount = 0;    // always >= 2, first and last frame included
+
+    std::vector<int> trackNodes;    // skeleton node driven by each track
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    // once compressed the arrays above are released and sampling decodes these keys
+    CompressedClip compressed;
+
+    size_t sourceMemory = 0;        // bytes of the aiNodeAnim keys the clip was baked from
+
+    size_t trackCount() const { return trackNodes.size(); }
+    bool isCompressed() const { return !compressed.empty(); }
+    size_t memoryUsage() const;
+};
+
+// Resample an aiAnimation against a skeleton. A sampleRate of 0 picks the
+// key density of the source clip (clamped to 30..120 Hz).
+bool bakeAnimationClip(const aiAnimation* animation, const Skeleton& skeleton, float sampleRate, AnimationClip& clip);
+
+// Quantize the baked tracks and drop keys that linear interpolation can rebuild.
+// errorBound is the largest allowed displacement at the bone tips, in model
+// units (rotation error times the distance to the farthest child joint).
+// Returns the memory used by the clip afterwards.
+size_t compressAnimationClip(AnimationClip& clip, const Skeleton& skeleton, float errorBound);
+
+// Overwrite the local TRS of every node the clip animates; other nodes are left untouched.
+// Tracks of nodes from nodeCount on (collapsed by the skeleton LOD) are skipped.
+void sampleAnimationClip(const AnimationClip& clip, float timeInSeconds, Pose& pose, size_t nodeCount = SIZE_MAX);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef ANIMATION_SCHEDULER_H
+#define ANIMATION_SCHEDULER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include "animated_model.h"
+
+// A character owned by the AnimationScheduler. The owner sets the inputs
+// before every AnimationScheduler::update and reads the instance afterwards.
+struct AnimatedCharacter {
+    explicit AnimatedCharacter(std::shared_ptr<const AnimatedModelAsset> asset) : instance(asset) {}
+    
+    AnimatedModelInstance instance;
+    
+    // inputs
+    glm::mat4 model = glm::mat4(1.0f);
+    float animationTime = 0.0f;     // time passed to updateAnimation
+    bool focus = false;             // evaluated every frame, even over the budget
+    bool allowCulling = true;
+    int forcedLod = -1;             // skeleton LOD, -1 picks it from the screen size
+    
+    // set by the scheduler
+    bool visible = true;
+    unsigned int interval = 1;      // frames between evaluations
+    
+    // scheduler state: the last two evaluations, blended on the frames between
+    unsigned long lastUpdateFrame = 0;
+    unsigned int phase = 0;
+    bool evaluated = false;
+    bool blending = false;
+    float lastAnimationTime = 0.0f;
+    float timeStep = 0.0f;          // animation time per frame, to predict the next evaluation
+    float fromTime = 0.0f;
+    float toTime = 0.0f;
+    Pose fromPalette;               // decomposed bone matrices
+    Pose toPalette;
+};
+
+struct AnimationSchedulerStats {
+    unsigned long evaluations = 0;
+    unsigned long interpolations = 0;   // frames served by blending two evaluations
+    unsigned long deferred = 0;         // due evaluations pushed back by the budget
+    unsigned long culled = 0;
+    double lastFrameMicroseconds = 0.0;
+};
+
+// Owns the animated characters and spreads their evaluation over frames.
+// Characters in focus or covering a large part of the screen are evaluated
+// every frame; smaller ones every 2nd, 4th or 8th frame (one per skeleton LOD
+// level), ahead of time, and their palette is blended between the last two
+// evaluations on the frames in between. An evaluation only starts if the
+// slowest recent one and a blend for every character still waiting fit in
+// the per-frame budget; the others are blended and wait, most overdue first
+// on the next frame. Only characters in focus or never evaluated go over the
+// budget, and so do the blends alone when there are too many characters for
+// it. Off-screen characters are not evaluated at all.
+class AnimationScheduler {
+public:
+    explicit AnimationScheduler(float budgetMicroseconds = 2000.0f);
+    
+    // the reference stays valid for the scheduler's lifetime
+    AnimatedCharacter& addCharacter(std::shared_ptr<const AnimatedModelAsset> asset);
+    size_t size() const { return m_Characters.size(); }
+    AnimatedCharacter& getCharacter(size_t index) { return *m_Characters[index]; }
+    
+    void update(const glm::mat4& view, const glm::mat4& projection);
+    
+    void setBudget(float budgetMicroseconds) { m_Budget = budgetMicroseconds; }
+    float getBudget() const { return m_Budget; }
+    const AnimationSchedulerStats& getStats() const { return m_Stats; }
+    
+private:
+    void evaluate(AnimatedCharacter& character);
+    void blend(AnimatedCharacter& character);
+    
+    std::vector<std::unique_ptr<AnimatedCharacter>> m_Characters;
+    std::vector<AnimatedCharacter*> m_Due;
+    float m_Budget;
+    double m_PeakCost = 0.0;            // microseconds, slowest recent evaluation, decays by 1% per evaluation
+    double m_AverageBlendCost = 0.0;    // microseconds per blend, running average
+    unsigned long m_Frame = 0;
+    AnimationSchedulerStats m_Stats;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef ANIMATION_TEXTURE_H
+#define ANIMATION_TEXTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+// Layout of a clip baked into a float texture (VertexAnimationTexture,
+// BoneAnimationTexture): whole frames of texelsPerFrame RGBA texels, one after
+// the other in rows of width texels. Read back by shaders/animation_texture.glsl.
+struct AnimationTextureLayout {
+    unsigned int frameCount = 0;    // 0 if nothing could be baked
+    float frameRate = 0.0f;
+    unsigned int width = 0;
+    unsigned int height = 0;
+};
+
+// Whole frames over the looping clip, the rate adjusted to fit, and fewer of
+// them if the texture would exceed GL_MAX_TEXTURE_SIZE. log prefixes the
+// messages, e.g. "VAT".
+AnimationTextureLayout fitAnimationTexture(float duration, float frameRate, size_t texelsPerFrame,
+                                           unsigned int maxWidth, const char* log);
+
+// Creates the texture with layout.width * layout.height texels from texels
+unsigned int uploadAnimationTexture(const AnimationTextureLayout& layout, GLenum internalFormat,
+                                    const std::vector<glm::vec4>& texels);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef BONE_ANIMATION_TEXTURE_H
+#define BONE_ANIMATION_TEXTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "animated_model_asset.h"
+#include "bounds.h"
+#include "shader.h"
+
+// texels per row of the baked texture
+#define BAT_TEXTURE_WIDTH 4096
+
+// Final bone matrices of one clip, baked at a fixed frame rate into a float
+// texture in the asset's palette order. The BONE_ANIMATION_TEXTURE variant of
+// the animated shaders samples and interpolates them by a per-instance clip
+// time, so skinning stays per vertex but nothing is evaluated or uploaded per
+// character. Much smaller than a VertexAnimationTexture, at the cost of the
+// skinning work.
+// Every frame holds the concatenated palettes, 3 texels (the top rows of the
+// matrix) per entry: entry e of frame f starts at texel 3 * (f * entryCount + e).
+class BoneAnimationTexture {
+public:
+    // The clip is played as a loop: the last frame blends back into the first
+    BoneAnimationTexture(std::shared_ptr<const AnimatedModelAsset> asset, unsigned int clipIndex, float frameRate = 30.0f);
+    ~BoneAnimationTexture();
+    // owns a GL texture
+    BoneAnimationTexture(const BoneAnimationTexture&) = delete;
+    BoneAnimationTexture& operator=(const BoneAnimationTexture&) = delete;
+    
+    void bind(unsigned int unit) const;
+    // Sets batTexture to unit and the layout uniforms on the bound program
+    void setUniforms(shader_program_t& program, unsigned int unit) const;
+    // Selects the palette of the next draws (batPaletteBase), see
+    // AnimatedModelAsset::drawSubmeshesInstanced
+    void setPalette(shader_program_t& program, unsigned int palette) const;
+    
+    unsigned int getFrameCount() const { return m_FrameCount; }
+    float getFrameRate() const { return m_FrameRate; }
+    // Model-space bounds over every baked frame
+    const BoundingBox& getBounds() const { return m_Bounds; }
+    size_t textureBytes() const { return (size_t)m_Width * m_Height * 16; }
+    
+private:
+    void bake(std::shared_ptr<const AnimatedModelAsset> asset, unsigned int clipIndex);
+    
+    unsigned int m_Texture = 0;
+    unsigned int m_Width = 0;
+    unsigned int m_Height = 0;
+    unsigned int m_FrameCount = 0;
+    unsigned int m_EntryCount = 0;
+    float m_FrameRate = 30.0f;
+    std::vector<int> m_PaletteBases;    // first entry of every palette
+    BoundingBox m_Bounds;
+};
+
+#endif
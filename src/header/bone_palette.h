@@ -0,0 +1,55 @@
+#ifndef BONE_PALETTE_H
+#define BONE_PALETTE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+// Uniform block binding point of the "BonePalette" block in the animated shaders
+#define BONE_PALETTE_BINDING 0
+
+// Bone matrices for all animated shaders in a single std140 uniform buffer,
+// written with one glBufferSubData per palette change.
+// The buffer holds one range per submesh palette (AnimatedModelAsset::m_Palettes),
+// each only with the bones its submesh references, and bind() selects the range
+// the next draw reads. maxBones is the size of the largest palette and becomes
+// MAX_BONES in the shaders.
+// The packed layout stores only the top three rows of each matrix (the last row
+// of a skinning matrix is always 0,0,0,1), 48 instead of 64 bytes per bone.
+class BonePalette {
+public:
+    BonePalette(unsigned int maxBones, bool packed3x4);
+    ~BonePalette();
+    BonePalette(const BonePalette&) = delete;
+    BonePalette& operator=(const BonePalette&) = delete;
+    
+    // matrices are the skeleton-wide final bone matrices, palettes[p][i] is the
+    // skeleton bone id of entry i of palette p, ids past count (PALETTE_IDENTITY_BONE)
+    // are uploaded as identity
+    void upload(const glm::mat4* matrices, size_t count, const std::vector<std::vector<unsigned int>>& palettes);
+    void bind(unsigned int palette = 0) const;
+    
+    // Points the program's BonePalette block at BONE_PALETTE_BINDING,
+    // returns false if the program has no such block
+    static bool bindProgram(unsigned int programId);
+    // Defines the animated shaders have to be compiled with to match the layout
+    std::string shaderDefines() const;
+    
+    bool isPacked() const { return m_Packed; }
+    unsigned int getMaxBones() const { return m_MaxBones; }
+    unsigned int getBufferId() const { return m_Buffer; }
+    size_t bytesPerBone() const { return m_Packed ? 3 * sizeof(glm::vec4) : sizeof(glm::mat4); }
+    // size of the uniform block, every palette range is bound with this size
+    size_t blockSize() const { return m_MaxBones * bytesPerBone(); }
+    
+private:
+    unsigned int m_Buffer = 0;
+    unsigned int m_MaxBones;
+    bool m_Packed;
+    size_t m_RangeStride = 0;        // blockSize() rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    size_t m_Capacity = 0;           // allocated bytes
+    std::vector<glm::vec4> m_Staging;
+};
+
+#endif
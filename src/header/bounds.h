@@ -0,0 +1,41 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+#include <cfloat>
+
+// Axis-aligned bounding box, empty until a point is added
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+    
+    bool isEmpty() const { return min.x > max.x; }
+    void reset() { *this = BoundingBox(); }
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    void expand(const BoundingBox& box) {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extent() const { return (max - min) * 0.5f; }
+    
+    // Box around this one after an affine transform (not a tight fit for rotations)
+    BoundingBox transformed(const glm::mat4& matrix) const;
+};
+
+// Six clip planes extracted from a view-projection matrix (or a full MVP, in
+// which case boxes are tested in model space)
+class Frustum {
+public:
+    explicit Frustum(const glm::mat4& clip);
+    // Conservative: may report boxes near the corners as visible
+    bool intersects(const BoundingBox& box) const;
+    
+private:
+    glm::vec4 m_Planes[6];
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 #include "camera.h"
+#include "skeleton.h"
 
 // keyframe structure
 struct Keyframe {
@@ -28,11 +29,11 @@ enum class ShotType {
 };
 
 // forward declaration
-class AnimatedModel;
+class AnimatedModelInstance;
 
 class CinematicDirector {
 public:
-    CinematicDirector(camera_t& cam, glm::mat4& charModel, glm::mat4& cartModel, AnimatedModel* animModel);
+    CinematicDirector(camera_t& cam, glm::mat4& charModel, glm::mat4& cartModel, AnimatedModelInstance* animModel);
     
     void Start();
     void Stop();
@@ -63,7 +64,7 @@ private:
     camera_t& m_Camera;
     glm::mat4& m_CharacterModel;
     glm::mat4& m_CartModel;
-    AnimatedModel* m_AnimatedModel;
+    AnimatedModelInstance* m_AnimatedModel;
     
     float m_GlobalTime;
     bool m_IsPlaying;
@@ -76,7 +77,14 @@ private:
     
     std::vector<Keyframe> m_Keyframes;
     
+    // head and spine bones turned towards the camera, resolved once
+    BoneHandle m_HeadBone;
+    BoneHandle m_SpineBone;
+    std::string m_HeadBoneName;
+    std::string m_SpineBoneName;
+    
     void InitializeKeyframes();
+    void ResolveBoneHandles();
     void InterpolateBetweenKeyframes(float currentTime);
     void UpdateCamera(glm::vec3 position, glm::vec3 target);
     float SmoothStep(float t);
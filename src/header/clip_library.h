@@ -0,0 +1,78 @@
+#ifndef CLIP_LIBRARY_H
+#define CLIP_LIBRARY_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "animation_clip.h"
+#include "mapped_file.h"
+
+// On-disk library of the baked (and compressed) clips of a model, memory
+// mapped. Opening it reads the table of clip names and lengths and checks the
+// per-track tables of every clip against its key arrays; the keys of a clip
+// are copied out of the mapping when it is first played, and trim()
+// drops the least recently sampled clips again once the resident keys exceed
+// the memory cap.
+class ClipLibrary {
+public:
+    // clips gets one entry per library clip with only name, duration and rate
+    // set; acquire() fills in the keys. The vector must outlive the library.
+    explicit ClipLibrary(std::vector<AnimationClip>& clips);
+    ClipLibrary(const ClipLibrary&) = delete;
+    ClipLibrary& operator=(const ClipLibrary&) = delete;
+
+    // sourceKey is the content hash of the model file the clips were imported
+    // from (see meshCacheKey), errorBound their compression bound, nodeCount the
+    // skeleton they track
+    static bool write(const std::string& path, const std::vector<AnimationClip>& clips, uint64_t sourceKey,
+                      float errorBound, size_t nodeCount);
+    // Fails if the file is missing, damaged (including key arrays that do not
+    // match their tracks), from another format version or written for another
+    // source or error bound. The skeleton is only known
+    // after the import, compare it with nodeCount() then.
+    bool open(const std::string& path, uint64_t sourceKey, float errorBound);
+
+    // Makes the keys of the clip resident and marks it as used this frame.
+    // Safe to call from several threads while no trim() runs.
+    const AnimationClip& acquire(unsigned int index);
+    // Evicts least recently used clips until the resident keys fit the cap,
+    // keeping every clip used since the previous trim(). Call once per frame,
+    // not while clips are being sampled.
+    void trim();
+
+    void setMemoryCap(size_t bytes) { m_MemoryCap = bytes; }
+    size_t getMemoryCap() const { return m_MemoryCap; }
+    size_t residentBytes() const { return m_ResidentBytes; }
+    unsigned int residentClips() const { return m_ResidentClips; }
+    size_t clipCount() const { return m_Entries.size(); }
+    size_t nodeCount() const { return m_NodeCount; }
+    size_t fileSize() const { return m_File.size(); }
+
+private:
+    struct Entry {
+        uint64_t offset = 0;        // keys of the clip in the file
+        uint64_t size = 0;
+    };
+    struct Slot {
+        std::atomic<bool> resident{ false };
+        std::atomic<unsigned int> lastUse{ 0 };
+        size_t bytes = 0;
+    };
+    void pageIn(unsigned int index);
+    static void releaseKeys(AnimationClip& clip);
+
+    std::vector<AnimationClip>& m_Clips;
+    MappedFile m_File;
+    std::vector<Entry> m_Entries;
+    std::unique_ptr<Slot[]> m_Slots;
+    std::mutex m_Mutex;                     // serializes page-ins
+    std::atomic<unsigned int> m_Frame{ 1 };
+    std::atomic<size_t> m_ResidentBytes{ 0 };
+    std::atomic<unsigned int> m_ResidentClips{ 0 };
+    size_t m_NodeCount = 0;
+    size_t m_MemoryCap = 16 * 1024 * 1024;
+};
+
+#endif
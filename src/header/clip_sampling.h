@@ -0,0 +1,52 @@
+#ifndef CLIP_SAMPLING_H
+#define CLIP_SAMPLING_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include "animation_clip.h"
+
+// Rotation interpolation used by sampleAnimationClip. The exact path slerps one
+// track at a time; the others collect the key pairs of all tracks and nlerp
+// them in one pass, with a correction of the blend factor that brings nlerp
+// close to constant angular velocity without an acos/sin per track.
+enum ClipSamplingKernel {
+    CLIP_SAMPLING_EXACT,        // glm::slerp per track
+    CLIP_SAMPLING_SCALAR,       // corrected nlerp, one track at a time
+    CLIP_SAMPLING_SSE,          // corrected nlerp, 4 tracks per instruction
+    CLIP_SAMPLING_AVX2,         // corrected nlerp, 8 tracks per instruction
+    CLIP_SAMPLING_KERNEL_COUNT
+};
+
+// Rotation key pairs of many tracks in SoA form, one lane per track.
+// interpolateRotations() leaves the result in the first key (x0 .. w0).
+struct RotationBatch {
+    std::vector<float> x0, y0, z0, w0;
+    std::vector<float> x1, y1, z1, w1;
+    std::vector<float> t;
+
+    size_t size() const { return t.size(); }
+    void resize(size_t count);
+    void set(size_t lane, const glm::quat& a, const glm::quat& b, float factor) {
+        x0[lane] = a.x; y0[lane] = a.y; z0[lane] = a.z; w0[lane] = a.w;
+        x1[lane] = b.x; y1[lane] = b.y; z1[lane] = b.z; w1[lane] = b.w;
+        t[lane] = factor;
+    }
+    glm::quat result(size_t lane) const { return glm::quat(w0[lane], x0[lane], y0[lane], z0[lane]); }
+};
+
+void interpolateRotations(RotationBatch& batch, ClipSamplingKernel kernel);
+
+// Process-wide kernel of sampleAnimationClip, falls back to the best supported
+// kernel if this CPU lacks the requested one. Set it between frames, not while
+// worker threads are sampling.
+void setClipSamplingKernel(ClipSamplingKernel kernel);
+ClipSamplingKernel getClipSamplingKernel();
+bool isClipSamplingKernelSupported(ClipSamplingKernel kernel);
+const char* clipSamplingKernelName(ClipSamplingKernel kernel);
+
+// Samples the clip four times per frame with every supported kernel and prints
+// the largest angular error against slerp and the tracks sampled per second
+void benchmarkClipSampling(const AnimationClip& clip, const Skeleton& skeleton);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef CPU_SKINNING_H
+#define CPU_SKINNING_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include "animated_model_asset.h"
+#include "worker_pool.h"
+
+enum SkinningMode {
+    SKINNING_LINEAR,            // matrix palette blend, same result as animated_*.vert
+    SKINNING_DUAL_QUATERNION    // no candy-wrapper collapse on twisting joints
+};
+
+enum CpuSkinningKernel {
+    CPU_SKINNING_SCALAR,
+    CPU_SKINNING_SSE,
+    CPU_SKINNING_AVX2
+};
+
+// Skins AnimatedModelAsset::vertices with a bone palette on the CPU, without
+// any GL calls. Used as a reference for the GPU skinning and as the skinning
+// path on machines without a GPU. Vertices are split in chunks over a worker pool.
+class CpuSkinner {
+public:
+    // threadCount 0 uses every hardware thread
+    explicit CpuSkinner(unsigned int threadCount = 0);
+    
+    // positions and normals are resized to vertices.size(); bone ids outside
+    // [0, boneCount) are ignored like in the shaders
+    void skin(const std::vector<Vertex>& vertices, const glm::mat4* palette, size_t boneCount,
+              std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals);
+    
+    void setMode(SkinningMode mode) { m_Mode = mode; }
+    SkinningMode getMode() const { return m_Mode; }
+    // falls back to the best supported kernel if this CPU lacks the requested one
+    void setKernel(CpuSkinningKernel kernel);
+    CpuSkinningKernel getKernel() const { return m_Kernel; }
+    unsigned int getThreadCount() const { return m_Pool.size(); }
+    
+    static bool isKernelSupported(CpuSkinningKernel kernel);
+    static const char* kernelName(CpuSkinningKernel kernel);
+    
+    // Times every kernel and mode on the given mesh and prints vertices/s per core
+    void benchmark(const std::vector<Vertex>& vertices, const glm::mat4* palette, size_t boneCount);
+    
+private:
+    // Rigid part of a bone matrix as a unit dual quaternion plus its axis scales
+    struct DualQuat {
+        glm::quat real;
+        glm::quat dual;
+        glm::vec3 scale;
+    };
+    void updateDualQuats(const glm::mat4* palette, size_t boneCount);
+    
+    WorkerPool m_Pool;
+    SkinningMode m_Mode = SKINNING_LINEAR;
+    CpuSkinningKernel m_Kernel = CPU_SKINNING_SCALAR;
+    std::vector<DualQuat> m_DualQuats;
+};
+
+#endif
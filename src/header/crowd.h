@@ -0,0 +1,116 @@
+#ifndef CROWD_H
+#define CROWD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include "animated_model_asset.h"
+#include "animated_model.h"
+#include "vertex_animation_texture.h"
+#include "bone_animation_texture.h"
+#include "worker_pool.h"
+
+// Background walkers drawn with one instanced draw per submesh, no
+// glDrawElements or palette upload per walker, only an instance matrix, clip
+// time and tint. Poses come from a baked animation texture, or from a skeleton
+// per walker evaluated on worker threads whose palettes are packed into one
+// texture buffer. Walkers go straight at their own speed and turn back at the
+// border of their area.
+class CrowdSystem {
+public:
+    // modelScale converts asset units to world units; walkSpeed (world units
+    // per second) is the speed the clip's steps match
+    CrowdSystem(std::shared_ptr<const AnimatedModelAsset> asset, float modelScale, float walkSpeed);
+    ~CrowdSystem();
+    CrowdSystem(const CrowdSystem&) = delete;
+    CrowdSystem& operator=(const CrowdSystem&) = delete;
+    
+    // Scatters count walkers over [areaMin, areaMax] on the ground plane (x, z),
+    // each with a random clip, time offset and tint
+    void spawn(unsigned int count, const glm::vec2& areaMin, const glm::vec2& areaMax, unsigned int seed = 1);
+    void update(float deltaTime);
+    // Upload the walkers inside the frustum and draw them, returning how many
+    // were drawn. With a vertex animation texture the caller binds a vat.vert
+    // program, the texture and its uniforms; with a bone animation texture the
+    // BONE_ANIMATION_TEXTURE variant of an animated shader, which gets the
+    // palette base of every submesh.
+    unsigned int render(const glm::mat4& view, const glm::mat4& projection, const VertexAnimationTexture& vat);
+    unsigned int render(const glm::mat4& view, const glm::mat4& projection, const BoneAnimationTexture& bat,
+                        shader_program_t& program);
+    
+    // Skinned crowd: poses every walker in view on the pool and gathers the
+    // palettes, then render() uploads them to a texture buffer on textureUnit
+    // and draws with the INSTANCED_PALETTE variant of an animated shader. As in
+    // AnimationScheduler, the skeleton LOD level doubles as the update rate: a
+    // walker is evaluated every 1, 2, 4 or 8 frames (staggered by walker) ahead
+    // of time, and its palette blended between the last two evaluations on the
+    // frames in between. Call once per frame after update().
+    void evaluatePoses(const glm::mat4& view, const glm::mat4& projection, WorkerPool& pool);
+    unsigned int render(shader_program_t& program, unsigned int textureUnit);
+    
+    size_t size() const { return m_Walkers.size(); }
+    
+private:
+    struct Walker {
+        glm::vec3 position;
+        float heading;      // radians around +Y, 0 walks towards +Z
+        float speed;
+        float timeOffset;
+        unsigned int clip;
+        glm::vec3 tint;
+    };
+    // per-instance vertex attributes, locations 7 to 12 after the asset's layout
+    struct InstanceData {
+        glm::mat4 model;
+        float time;
+        glm::vec3 tint;
+    };
+    // skinned crowd, pose and evaluation state of one walker
+    struct WalkerPose {
+        std::unique_ptr<AnimatedModelInstance> instance;
+        unsigned int interval = 1;          // frames between evaluations
+        unsigned long lastUpdateFrame = 0;
+        unsigned long lastVisibleFrame = 0;
+        bool evaluated = false;
+        bool blending = false;
+        float fromTime = 0.0f;
+        float toTime = 0.0f;
+        Pose fromPalette;                   // decomposed bone matrices
+        Pose toPalette;
+    };
+    glm::mat4 modelMatrix(const Walker& walker) const;
+    // Fills the instance buffer with the walkers whose clip bounds are in view
+    unsigned int uploadInstances(const glm::mat4& viewProjection, const BoundingBox& clipBounds);
+    void uploadInstanceBuffer();
+    float clipTime(const Walker& walker) const;
+    void poseWalker(WalkerPose& state, size_t index, float time, float timeStep);
+    
+    std::shared_ptr<const AnimatedModelAsset> m_Asset;
+    float m_ModelScale;
+    float m_WalkSpeed;
+    float m_Time = 0.0f;
+    float m_DeltaTime = 0.0f;
+    glm::vec2 m_AreaMin = glm::vec2(0.0f);
+    glm::vec2 m_AreaMax = glm::vec2(0.0f);
+    std::vector<Walker> m_Walkers;
+    std::vector<InstanceData> m_Instances;
+    unsigned int m_VAO = 0;
+    unsigned int m_InstanceBuffer = 0;
+    size_t m_InstanceCapacity = 0;
+    
+    // skinned crowd, one skeleton per walker created on the first evaluatePoses()
+    std::vector<WalkerPose> m_Poses;
+    unsigned long m_Frame = 0;
+    std::vector<size_t> m_VisibleWalkers;
+    std::vector<glm::vec4> m_PaletteRows;   // 3 rows per entry, entries of all asset palettes per instance
+    unsigned int m_EntryCount = 0;          // palette entries per instance
+    unsigned int m_PaletteBuffer = 0;
+    unsigned int m_PaletteTexture = 0;
+    size_t m_PaletteCapacity = 0;
+    size_t m_MaxPaletteTexels = 0;          // GL_MAX_TEXTURE_BUFFER_SIZE
+    bool m_LimitWarned = false;
+    std::vector<int> m_PaletteBases;        // first entry of every asset palette
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+// Read-only memory mapping of a whole file. Nothing is read up front, the OS
+// pages the bytes in on first access and can drop them again under pressure.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_Data != nullptr; }
+    const uint8_t* data() const { return m_Data; }
+    size_t size() const { return m_Size; }
+
+private:
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
+
+// Bounds-checked reads of plain values and arrays out of a mapped file. Arrays
+// are a uint32 element count followed by the raw elements, padded to 4 bytes;
+// after the first failed read every further read fails as well.
+class BinaryReader {
+public:
+    BinaryReader(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (!m_Ok || m_Size - m_Offset < sizeof(T)) return m_Ok = false;
+        std::memcpy(&value, m_Data + m_Offset, sizeof(T));
+        m_Offset += sizeof(T);
+        return true;
+    }
+    template <typename T>
+    bool readArray(std::vector<T>& values) {
+        uint32_t count = 0;
+        if (!read(count) || (m_Size - m_Offset) / sizeof(T) < count) return m_Ok = false;
+        values.resize(count);
+        if (count > 0) std::memcpy(values.data(), m_Data + m_Offset, count * sizeof(T));
+        m_Offset = std::min(m_Offset + ((count * sizeof(T) + 3) & ~(size_t)3), m_Size);
+        return true;
+    }
+    // Points values at the elements inside the data instead of copying them
+    template <typename T>
+    bool viewArray(const T*& values, uint32_t& count) {
+        if (!read(count) || (m_Size - m_Offset) / sizeof(T) < count) return m_Ok = false;
+        values = (const T*)(m_Data + m_Offset);
+        m_Offset = std::min(m_Offset + ((count * sizeof(T) + 3) & ~(size_t)3), m_Size);
+        return true;
+    }
+    bool readString(std::string& value) {
+        std::vector<char> chars;
+        if (!readArray(chars)) return false;
+        value.assign(chars.begin(), chars.end());
+        return true;
+    }
+    bool seek(size_t offset) {
+        if (offset > m_Size) return m_Ok = false;
+        m_Offset = offset;
+        return m_Ok;
+    }
+    bool ok() const { return m_Ok; }
+    size_t remaining() const { return m_Size - m_Offset; }
+
+private:
+    const uint8_t* m_Data;
+    size_t m_Size;
+    size_t m_Offset = 0;
+    bool m_Ok = true;
+};
+
+template <typename T>
+void writeBinary(std::ostream& out, const T& value) {
+    out.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+void writeBinaryArray(std::ostream& out, const T* values, size_t count) {
+    writeBinary(out, (uint32_t)count);
+    if (count > 0) out.write((const char*)values, count * sizeof(T));
+    static const char padding[4] = {};
+    out.write(padding, (4 - (count * sizeof(T)) % 4) % 4);
+}
+
+template <typename T>
+void writeBinaryArray(std::ostream& out, const std::vector<T>& values) {
+    writeBinaryArray(out, values.data(), values.size());
+}
+
+inline void writeBinaryString(std::ostream& out, const std::string& value) {
+    writeBinaryArray(out, value.data(), value.size());
+}
+
+// 64-bit FNV-1a, pass the previous result as hash to continue it
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+#endif
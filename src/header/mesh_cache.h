@@ -0,0 +1,26 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <ostream>
+#include <functional>
+#include <cstdint>
+#include "mapped_file.h"
+
+// Binary cache of an imported model next to the model file ("<path>.meshcache"),
+// holding what the loader built from the Assimp scene so warm starts skip the
+// import. The file is a versioned header and a payload the model class writes
+// and reads itself; it is only valid for the key it was written with.
+
+// Cache key: FNV-1a over the model file's contents, continued from options, the
+// hash of the import flags and every setting that changes the payload
+bool meshCacheKey(const std::string& sourcePath, uint64_t options, uint64_t& key);
+
+// Writes the header and the payload writePayload produces, false on any I/O error
+bool writeMeshCache(const std::string& path, uint64_t key, const std::function<void(std::ostream&)>& writePayload);
+
+// Maps the cache and points payload at what follows the header. Fails if the
+// file is missing, truncated, from another format version or another key.
+bool openMeshCache(const std::string& path, uint64_t key, MappedFile& file, BinaryReader& payload);
+
+#endif
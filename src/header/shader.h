@@ -1,3 +1,6 @@
+#ifndef SHADER_H
+#define SHADER_H
+
 #include <vector>
 #include <string>
 
@@ -5,7 +8,10 @@ class shader_program_t{
 public:
     shader_program_t();
     ~shader_program_t();
-    void add_shader(std::string& filepath, unsigned int type);
+    // defines are inserted after the #version line, e.g. "#define BONE_PALETTE_3X4\n"
+    void add_shader(std::string& filepath, unsigned int type, const std::string& defines = "");
+    // capture these vertex outputs interleaved with transform feedback, call before link_shader
+    void set_feedback_varyings(const std::vector<const char*>& varyings);
     void link_shader();
     void create();
     void use();
@@ -16,8 +22,12 @@ public:
     void set_uniform_value(const char* name, const float value);
     void set_uniform_value(const char* name, const int value);
     unsigned int get_program_id() const { return program_handle; }
+    // whole file, e.g. a shared snippet to pass to add_shader after the defines
+    static std::string read_source(const std::string& filepath);
     
 private:
     unsigned int program_handle;
     std::vector<unsigned int> shader_handles;
-};
\ No newline at end of file
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <assimp/scene.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <ostream>
+#include "mapped_file.h"
+
+// Skeleton LOD levels, 0 evaluates every node
+#define SKELETON_LOD_COUNT 4
+
+struct BoneInfo {
+    int id;
+    glm::mat4 offset;
+};
+
+// Node hierarchy flattened into arrays sorted so that every parent comes
+// before its children. Built once from the aiScene, evaluation never touches
+// Assimp afterwards.
+// LOD levels collapse short leaf chains (fingers, toes, end bones) into their
+// parents. Nodes are ordered by the level they collapse at, so LOD l only
+// evaluates the first lodNodeCounts[l] nodes; the palette entries of collapsed
+// bones copy the entry of their nearest kept bone ancestor.
+struct Skeleton {
+    std::vector<std::string> names;
+    std::vector<int> parents;               // -1 for the root, otherwise parents[i] < i
+    std::vector<int> boneIndices;           // slot in the final bone palette, -1 if not a bone
+    std::vector<glm::mat4> offsets;         // bone offset matrix (identity for non-bones)
+
+    // bind-pose local transform of every node, split into TRS
+    std::vector<glm::vec3> bindTranslations;
+    std::vector<glm::quat> bindRotations;
+    std::vector<glm::vec3> bindScales;
+
+    std::vector<unsigned int> lodNodeCounts;                    // per LOD level
+    std::vector<std::vector<std::pair<int, int>>> lodBoneAliases; // per LOD level: (bone, kept bone)
+
+    void build(const aiNode* root, const std::map<std::string, BoneInfo>& boneInfoMap);
+    // Stores the built skeleton in a mesh cache and restores it without the aiScene
+    void write(std::ostream& out) const;
+    bool read(BinaryReader& in);
+    int findNode(const std::string& name) const;
+    size_t size() const { return parents.size(); }
+    size_t lodNodeCount(unsigned int lod) const {
+        return lod < lodNodeCounts.size() ? lodNodeCounts[lod] : size();
+    }
+
+private:
+    std::unordered_map<std::string, int> m_NodeLookup;
+    void addNode(const aiNode* node, int parent, const std::map<std::string, BoneInfo>& boneInfoMap);
+    void buildLods();
+};
+
+// Skeleton node resolved once by name, so per-frame code does no string lookups
+struct BoneHandle {
+    int node = -1;
+    bool isValid() const { return node >= 0; }
+};
+
+// Local-space pose, one entry per skeleton node, each channel in its own array
+struct Pose {
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    void resize(size_t count);
+    void setToBindPose(const Skeleton& skeleton);
+};
+
+// Weighted blend of several local poses: translations and scales are averaged,
+// rotations are nlerp-ed (sign-aligned to the first pose, then normalized).
+// Weights are normalized by their sum. Only the first nodeCount nodes are blended.
+void blendPoses(const Pose* poses, const float* weights, size_t poseCount, Pose& result, size_t nodeCount = SIZE_MAX);
+
+glm::mat4 composeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+// Single linear pass: local TRS -> global matrices -> final bone palette,
+// over the nodes kept at the given LOD level
+void evaluateSkeleton(const Skeleton& skeleton, const Pose& pose,
+                      std::vector<glm::mat4>& globalTransforms,
+                      std::vector<glm::mat4>& finalBoneMatrices,
+                      unsigned int lod = 0);
+
+#endif
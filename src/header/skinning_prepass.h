@@ -0,0 +1,50 @@
+#ifndef SKINNING_PREPASS_H
+#define SKINNING_PREPASS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include "animated_model_asset.h"
+#include "shader.h"
+#include "bone_palette.h"
+
+// Skins a character once per palette change with transform feedback into a
+// buffer of plain positions and normals. Every pass of the frame (lighting,
+// explode, depth...) then draws that buffer with the PRE_SKINNED variant of
+// its shader instead of repeating the skinning loop.
+// One prepass per instance, the asset must outlive it.
+class SkinningPrepass {
+public:
+    // paletteDefines must match the layout of the bound BonePalette buffer
+    SkinningPrepass(const AnimatedModelAsset& asset, const std::string& shaderDir, const std::string& paletteDefines);
+    ~SkinningPrepass();
+    SkinningPrepass(const SkinningPrepass&) = delete;
+    SkinningPrepass& operator=(const SkinningPrepass&) = delete;
+    
+    // Runs the prepass if paletteVersion differs from the last one it skinned,
+    // the bone palette has to be uploaded. Returns true if it ran.
+    bool update(unsigned int paletteVersion, const BonePalette& palette);
+    // Forces the next update to run, e.g. after switching instances
+    void invalidate() { m_HasOutput = false; }
+    // Draws the skinned mesh, the caller binds a PRE_SKINNED program and the texture
+    void draw() const;
+    
+    unsigned int getSkinnedVAO() const { return m_SkinnedVAO; }
+    unsigned int getOutputBuffer() const { return m_OutputBuffer; }
+    
+private:
+    // layout of one captured vertex
+    struct SkinnedVertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+    
+    const AnimatedModelAsset& m_Asset;
+    shader_program_t m_Program;
+    unsigned int m_OutputBuffer = 0;
+    unsigned int m_SkinnedVAO = 0;
+    unsigned int m_LastPaletteVersion = 0;
+    bool m_HasOutput = false;
+};
+
+#endif
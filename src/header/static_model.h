@@ -10,6 +10,8 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <cstdint>
+#include "mesh_cache.h"
 
 struct StaticVertex {
     glm::vec3 Position;
@@ -26,6 +28,9 @@ struct Material {
     unsigned int texture;
 };
 
+// Geometry and materials of an OBJ file. The imported mesh is kept in a mesh
+// cache next to the model file ("<path>.meshcache"), a warm start maps it
+// instead of running Assimp.
 class StaticModel {
 public:
     std::vector<StaticVertex> vertices;
@@ -35,7 +40,7 @@ public:
     
     unsigned int VAO, VBO, EBO;
     
-    const aiScene* m_scene;
+    const aiScene* m_scene = nullptr;           // null when loaded from the mesh cache
     Assimp::Importer m_Importer;
     
     StaticModel(const std::string& path);
@@ -48,6 +53,12 @@ public:
     unsigned int getMaterialTexture(unsigned int materialIndex);
     
 private:
+    // Assimp import into the arrays above; texturePaths gets the diffuse
+    // texture of every material relative to the model directory
+    bool importModel(const std::string& path, unsigned int importFlags, std::vector<std::string>& texturePaths);
+    bool loadMeshCache(const std::string& path, uint64_t key, std::vector<std::string>& texturePaths);
+    bool saveMeshCache(const std::string& path, uint64_t key, const std::vector<std::string>& texturePaths) const;
+    
     std::string directory;
     std::map<std::string, unsigned int> textureCache;
     std::map<unsigned int, unsigned int> materialTextureCache; // Cache for material color textures
@@ -0,0 +1,55 @@
+#ifndef VERTEX_ANIMATION_TEXTURE_H
+#define VERTEX_ANIMATION_TEXTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "animated_model_asset.h"
+#include "bounds.h"
+#include "shader.h"
+
+// texels per row of the baked texture
+#define VAT_TEXTURE_WIDTH 4096
+
+// Skinned positions and normals of one clip, baked at a fixed frame rate into a
+// float texture. vat.vert fetches them by gl_VertexID and time, so characters
+// drawn with it need no skeleton evaluation, bone palette or skinning.
+// Texel 2 * (frame * vertexCount + vertex) holds the position, the next one the
+// normal, in rows of VAT_TEXTURE_WIDTH texels.
+class VertexAnimationTexture {
+public:
+    // The clip is played as a loop: the last frame blends back into the first.
+    // halfFloat stores RGBA16F (half the memory, ~1/1000 relative position error)
+    VertexAnimationTexture(std::shared_ptr<const AnimatedModelAsset> asset, unsigned int clipIndex,
+                           float frameRate = 30.0f, bool halfFloat = false);
+    ~VertexAnimationTexture();
+    // owns a GL texture
+    VertexAnimationTexture(const VertexAnimationTexture&) = delete;
+    VertexAnimationTexture& operator=(const VertexAnimationTexture&) = delete;
+    
+    void bind(unsigned int unit) const;
+    // Sets vatTexture to unit and the layout uniforms on a program using vat.vert
+    void setUniforms(shader_program_t& program, unsigned int unit) const;
+    
+    unsigned int getFrameCount() const { return m_FrameCount; }
+    float getFrameRate() const { return m_FrameRate; }
+    unsigned int getVertexCount() const { return m_VertexCount; }
+    // Model-space bounds over every baked frame
+    const BoundingBox& getBounds() const { return m_Bounds; }
+    size_t textureBytes() const;
+    
+private:
+    void bake(std::shared_ptr<const AnimatedModelAsset> asset, unsigned int clipIndex);
+    
+    unsigned int m_Texture = 0;
+    unsigned int m_Width = 0;
+    unsigned int m_Height = 0;
+    unsigned int m_FrameCount = 0;
+    unsigned int m_VertexCount = 0;
+    float m_FrameRate = 30.0f;
+    bool m_HalfFloat = false;
+    BoundingBox m_Bounds;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Fixed set of worker threads for data-parallel loops. parallelFor splits
+// [0, count) into chunks of `grain` items that the workers and the calling
+// thread pull until none are left, and returns once all of them ran.
+// Not reentrant: a task must not call parallelFor on the same pool.
+class WorkerPool {
+public:
+    // threadCount counts the calling thread, 0 uses one per hardware thread
+    explicit WorkerPool(unsigned int threadCount = 0);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& task);
+    unsigned int size() const { return (unsigned int)m_Threads.size() + 1; }
+    
+private:
+    void workerLoop();
+    void runChunks();
+    
+    std::vector<std::thread> m_Threads;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeUp;
+    std::condition_variable m_Done;
+    
+    const std::function<void(size_t, size_t)>* m_Task = nullptr;
+    size_t m_Count = 0;
+    size_t m_Grain = 1;
+    std::atomic<size_t> m_Next;
+    unsigned int m_Busy = 0;           // workers still running the current loop
+    unsigned int m_Generation = 0;     // bumped for every parallelFor
+    bool m_Quit = false;
+};
+
+#endif
@@ -14,6 +14,14 @@
 
 #include "header/cube.h"
 #include "header/animated_model.h"
+#include "header/animation_scheduler.h"
+#include "header/bone_palette.h"
+#include "header/cpu_skinning.h"
+#include "header/clip_sampling.h"
+#include "header/skinning_prepass.h"
+#include "header/vertex_animation_texture.h"
+#include "header/bone_animation_texture.h"
+#include "header/crowd.h"
 #include "header/static_model.h"
 #include "header/shader.h"
 #include "header/stb_image.h"
@@ -130,10 +138,63 @@ light_t light;
 material_t material;
 camera_t camera;
 
-// animated model
-AnimatedModel* animatedModel;
+// animated model: the asset is loaded once, instances only hold playback state.
+// Characters are owned by the scheduler, which spreads their updates over frames.
+std::shared_ptr<AnimatedModelAsset> animatedAsset;
+AnimationScheduler* animationScheduler = nullptr;
+AnimatedCharacter* heroCharacter = nullptr;
+AnimatedModelInstance* animatedModel;
+float animationBudgetMicroseconds = 2000.0f;
+bool quantizeVertexPositions = false;   // unorm16 positions inside the mesh bounds
+int boneInfluences = 4;                 // most bones per vertex: 1, 2, 4 or 8
+
+// bone palette uniform buffer shared by all animated shaders, one range per submesh palette
+BonePalette* bonePalette = nullptr;
+bool packedBonePalette = true;  // upload 3x4 matrices instead of 4x4
+
+// skin once per frame with transform feedback, passes then draw the skinned buffer
+// with the PRE_SKINNED shader variants
+SkinningPrepass* skinningPrepass = nullptr;
+bool enableSkinningPrepass = true;
+std::vector<shader_program_t*> preSkinnedPrograms;
+
+// background walkers played from an animation texture of the walk clip (baked
+// skinned vertices, or baked bone matrices skinned per vertex), or with a
+// skeleton each evaluated on crowdWorkers and skinned from one palette buffer
+enum CrowdMode { CROWD_OFF, CROWD_VERTEX_TEXTURE, CROWD_BONE_TEXTURE, CROWD_SKINNED, CROWD_MODE_COUNT };
+VertexAnimationTexture* walkVat = nullptr;
+BoneAnimationTexture* walkBat = nullptr;
+CrowdSystem* crowdSystem = nullptr;
+WorkerPool* crowdWorkers = nullptr;
+shader_program_t* vatShader = nullptr;
+shader_program_t* batShader = nullptr;
+shader_program_t* crowdSkinnedShader = nullptr;
+int crowdMode = CROWD_OFF;      // G opts in, the walkers share the scene with the cinematic
+unsigned int crowdSize = 1000;
+shader_program_t* preSkinnedExplodeShader = nullptr;
+
+// CPU skinning reference, created on first use
+CpuSkinner* cpuSkinner = nullptr;
 glm::mat4 modelMatrix;
 
+// skeleton LOD picked from the character's screen size, or forced with the L key
+int forcedSkeletonLod = -1;     // -1: automatic
+// frames the character was neither animated nor drawn, its bounds being off-screen
+unsigned long culledFrames = 0;
+
+glm::mat4 getViewMatrix() {
+    return glm::lookAt(camera.position + glm::vec3(0.0f, -0.2f, -0.1f), camera.position + camera.front, camera.up);
+}
+
+glm::mat4 getProjectionMatrix() {
+    return glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+}
+
+// The explode pieces fly outside the skinned bounds, so it is never culled then
+bool isCharacterVisible() {
+    return enableExplode || animatedModel->isVisible(modelMatrix, getViewMatrix(), getProjectionMatrix());
+}
+
 // static model (cart)
 StaticModel* cartModel = nullptr;
 glm::mat4 cartMatrix;
@@ -164,15 +225,23 @@ void model_setup(){
 #endif
 
     // Load the animated FBX model
-    animatedModel = new AnimatedModel(fbx_file);
+    animatedAsset = std::make_shared<AnimatedModelAsset>(fbx_file, 0.01f, quantizeVertexPositions, boneInfluences);
     
     // Load texture manually (FBX may or may not have embedded texture)
 #if defined(__linux__) || defined(__APPLE__)
-    animatedModel->loadTexture("asset/texture/rp_eric_rigged_001_dif.jpg");
+    animatedAsset->loadTexture("asset/texture/rp_eric_rigged_001_dif.jpg");
 #else
-    animatedModel->loadTexture("..\\..\\src\\asset\\texture\\rp_eric_rigged_001_dif.jpg");
+    animatedAsset->loadTexture("..\\..\\src\\asset\\texture\\rp_eric_rigged_001_dif.jpg");
 #endif
     
+    // the hero is in focus: evaluated every frame whatever its size on screen
+    animationScheduler = new AnimationScheduler(animationBudgetMicroseconds);
+    heroCharacter = &animationScheduler->addCharacter(animatedAsset);
+    heroCharacter->focus = true;
+    animatedModel = &heroCharacter->instance;
+    std::cout << "Animated asset: " << animatedAsset->memoryUsage() / 1024.0f << " KB, per instance: "
+              << animatedModel->memoryUsage() / 1024.0f << " KB" << std::endl;
+    
     modelMatrix = glm::mat4(1.0f);
     modelMatrix = glm::scale(modelMatrix, glm::vec3(0.1f, 0.1f, 0.1f));
     // initial position: x=150, z=100, facing right (rotate -90 degrees around Y axis to make character face +X direction)
@@ -329,6 +398,57 @@ void rain_setup(){
         rainSystem->setup();
     }
     
+void crowd_setup(){
+    #if defined(__linux__) || defined(__APPLE__)
+        std::string shaderDir = "shaders/";
+    #else
+        std::string shaderDir = "..\\..\\src\\shaders\\";
+    #endif
+    
+        if (animatedAsset->getClipCount() == 0) return;
+        walkVat = new VertexAnimationTexture(animatedAsset, 0, 30.0f);
+        walkBat = new BoneAnimationTexture(animatedAsset, 0, 30.0f);
+    
+        std::string vpath = shaderDir + "vat.vert";
+        std::string fpath = shaderDir + "bling-phong.frag";
+        vatShader = new shader_program_t();
+        vatShader->create();
+        std::string animationTexture = shader_program_t::read_source(shaderDir + "animation_texture.glsl");
+        vatShader->add_shader(vpath, GL_VERTEX_SHADER, animationTexture);
+        vatShader->add_shader(fpath, GL_FRAGMENT_SHADER, "#define INSTANCE_TINT\n");
+        vatShader->link_shader();
+    
+        std::string batPath = shaderDir + "animated_bling-phong.vert";
+        std::string skinningCommon = shader_program_t::read_source(shaderDir + "skinning_common.glsl");
+        batShader = new shader_program_t();
+        batShader->create();
+        batShader->add_shader(batPath, GL_VERTEX_SHADER,
+                              "#define BONE_ANIMATION_TEXTURE\n" + animatedAsset->shaderDefines() + animationTexture +
+                              skinningCommon);
+        batShader->add_shader(fpath, GL_FRAGMENT_SHADER, "#define INSTANCE_TINT\n");
+        batShader->link_shader();
+    
+        crowdSkinnedShader = new shader_program_t();
+        crowdSkinnedShader->create();
+        crowdSkinnedShader->add_shader(batPath, GL_VERTEX_SHADER,
+                                       "#define INSTANCED_PALETTE\n" + animatedAsset->shaderDefines() + skinningCommon);
+        crowdSkinnedShader->add_shader(fpath, GL_FRAGMENT_SHADER, "#define INSTANCE_TINT\n");
+        crowdSkinnedShader->link_shader();
+        if (animatedAsset->hasQuantizedPositions()) {
+            for (shader_program_t* program : { batShader, crowdSkinnedShader }) {
+                program->use();
+                program->set_uniform_value("positionOffset", animatedAsset->getPositionOffset());
+                program->set_uniform_value("positionScale", animatedAsset->getPositionScale());
+                program->release();
+            }
+        }
+    
+        // same scale as the hero, walking at about 1.4 m/s
+        crowdSystem = new CrowdSystem(animatedAsset, 0.1f, 14.0f);
+        crowdWorkers = new WorkerPool();
+        crowdSystem->spawn(crowdSize, glm::vec2(-150.0f, -150.0f), glm::vec2(150.0f, 150.0f));
+    }
+    
 //////////////////////////////////////////////////////////////////////////
 
 void shader_setup(){
@@ -342,6 +462,21 @@ void shader_setup(){
         "default", "bling-phong", "gouraud", "metallic", "glass_schlick"
     };
 
+    bonePalette = new BonePalette(animatedModel->getAsset().maxPaletteSize(), packedBonePalette);
+    std::string paletteDefines = bonePalette->shaderDefines();
+    std::string skinningDefines = paletteDefines + animatedModel->getAsset().shaderDefines();
+    // vertex inputs and skinning of every animated_*.vert, after the defines it depends on
+    std::string skinningCommon = shader_program_t::read_source(shaderDir + "skinning_common.glsl");
+    // dequantization of the packed positions, constant for the asset
+    auto setVertexLayoutUniforms = [](shader_program_t* program) {
+        const AnimatedModelAsset& asset = animatedModel->getAsset();
+        if (!asset.hasQuantizedPositions()) return;
+        program->use();
+        program->set_uniform_value("positionOffset", asset.getPositionOffset());
+        program->set_uniform_value("positionScale", asset.getPositionScale());
+        program->release();
+    };
+
     // Create animated versions of all original shaders
     for(int i=0; i<shadingMethod.size(); i++){
         std::string vpath = shaderDir + "animated_" + shadingMethod[i] + ".vert";
@@ -349,10 +484,20 @@ void shader_setup(){
 
         shader_program_t* shaderProgram = new shader_program_t();
         shaderProgram->create();
-        shaderProgram->add_shader(vpath, GL_VERTEX_SHADER);
+        shaderProgram->add_shader(vpath, GL_VERTEX_SHADER, skinningDefines + skinningCommon);
         shaderProgram->add_shader(fpath, GL_FRAGMENT_SHADER);
         shaderProgram->link_shader();
+        BonePalette::bindProgram(shaderProgram->get_program_id());
+        setVertexLayoutUniforms(shaderProgram);
         shaderPrograms.push_back(shaderProgram);
+
+        // same shading on the output of the skinning prepass
+        shader_program_t* preSkinnedProgram = new shader_program_t();
+        preSkinnedProgram->create();
+        preSkinnedProgram->add_shader(vpath, GL_VERTEX_SHADER, "#define PRE_SKINNED\n" + skinningCommon);
+        preSkinnedProgram->add_shader(fpath, GL_FRAGMENT_SHADER);
+        preSkinnedProgram->link_shader();
+        preSkinnedPrograms.push_back(preSkinnedProgram);
     }
     
     // Create static model shader (for cart)
@@ -382,10 +527,22 @@ void shader_setup(){
     std::string explodeVertPath = shaderDir + "animated_explode.vert";
     std::string explodeGeomPath = shaderDir + "animated_explode.geom";
     std::string explodeFragPath = shaderDir + "animated_explode.frag";
-    explodeShader->add_shader(explodeVertPath, GL_VERTEX_SHADER);
+    explodeShader->add_shader(explodeVertPath, GL_VERTEX_SHADER, skinningDefines + skinningCommon);
     explodeShader->add_shader(explodeGeomPath, GL_GEOMETRY_SHADER);
     explodeShader->add_shader(explodeFragPath, GL_FRAGMENT_SHADER);
     explodeShader->link_shader();
+    BonePalette::bindProgram(explodeShader->get_program_id());
+    setVertexLayoutUniforms(explodeShader);
+
+    preSkinnedExplodeShader = new shader_program_t();
+    preSkinnedExplodeShader->create();
+    preSkinnedExplodeShader->add_shader(explodeVertPath, GL_VERTEX_SHADER, "#define PRE_SKINNED\n" + skinningCommon);
+    preSkinnedExplodeShader->add_shader(explodeGeomPath, GL_GEOMETRY_SHADER);
+    preSkinnedExplodeShader->add_shader(explodeFragPath, GL_FRAGMENT_SHADER);
+    preSkinnedExplodeShader->link_shader();
+
+    // the prepass skins into its own buffer, the model has been loaded by model_setup()
+    skinningPrepass = new SkinningPrepass(animatedModel->getAsset(), shaderDir, paletteDefines);
 
     // Create burning shader
     burningShader = new shader_program_t();
@@ -450,6 +607,7 @@ void setup(){
     cubemap_setup();
     material_setup();
     rain_setup();
+    crowd_setup();
     
     // Initialize cinematic director (pass animatedModel for head rotation control)
     cinematicDirector = new CinematicDirector(camera, modelMatrix, cartMatrix, animatedModel);
@@ -495,8 +653,29 @@ void update(){
         }
     }
     
-    // update model animation with limited animation time (stop walking animation)
-    animatedModel->updateAnimation(animationTimeForModel);
+    // The scheduler skips characters whose last pose bounds are off-screen, picks
+    // their skeleton LOD from last frame's placement and evaluates them within
+    // its budget. The hero uses the limited animation time (stop walking animation).
+    heroCharacter->model = modelMatrix;
+    heroCharacter->animationTime = animationTimeForModel;
+    heroCharacter->allowCulling = !enableExplode;
+    heroCharacter->forcedLod = forcedSkeletonLod;
+    animationScheduler->update(getViewMatrix(), getProjectionMatrix());
+    if (!heroCharacter->visible) {
+        culledFrames++;
+    }
+
+    // background walkers move, their poses come from an animation texture or
+    // are evaluated on the worker threads
+    if (crowdMode != CROWD_OFF && crowdSystem) {
+        crowdSystem->update(deltaTime);
+        if (crowdMode == CROWD_SKINNED) {
+            crowdSystem->evaluatePoses(getViewMatrix(), getProjectionMatrix(), *crowdWorkers);
+        }
+    }
+    
+    // every clip of this frame is sampled, drop the ones not played lately
+    animatedAsset->trimClips();
 
     // Update character and cart movement based on animation time
     if (cinematicDirector) {
@@ -563,8 +742,8 @@ void render(){
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // calculate view, projection matrix using new camera system
-    glm::mat4 view = glm::lookAt(camera.position + glm::vec3(0.0f, -0.2f, -0.1f), camera.position + camera.front, camera.up);
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+    glm::mat4 view = getViewMatrix();
+    glm::mat4 projection = getProjectionMatrix();
 
     // rain
     if (enableRain) {
@@ -646,22 +825,39 @@ void render(){
         glEnable(GL_CULL_FACE);
     }
 
-    // Render animated model
+    // Render animated model, unless its pose bounds are outside the frustum
+    bool characterVisible = isCharacterVisible();
+    
+    // Set bone matrices for animation: one buffer update serves every animated
+    // shader, and is skipped when the palette did not change
+    if (characterVisible && animatedModel->shouldUploadPalette(bonePalette->getBufferId())) {
+        bonePalette->upload(animatedModel->m_FinalBoneMatrices.data(), animatedModel->m_FinalBoneMatrices.size(),
+                            animatedModel->getAsset().m_Palettes);
+    }
+    
+    // skin once, every pass below reads the skinned vertices
+    bool usePrepass = enableSkinningPrepass && skinningPrepass;
+    if (characterVisible && usePrepass) {
+        skinningPrepass->update(animatedModel->getPaletteVersion(), *bonePalette);
+    }
+    
     // determine whether to use explode effect
     shader_program_t* currentShader = nullptr;
     float explodeStrength = 0.0f;
+    bool exploding = false;
     
     if (enableExplode && explodeShader) {
-        currentShader = explodeShader;
+        currentShader = usePrepass ? preSkinnedExplodeShader : explodeShader;
+        exploding = true;
         // calculate explode strength (0.0 to 1.0+)
         float timeSinceExplode = currentTime - explodeStartTime;
         explodeStrength = timeSinceExplode / explodeDuration;
         // no upper limit, allow explosion to continue spreading
     } else if (shaderProgramIndex < shaderPrograms.size()) {
-        currentShader = shaderPrograms[shaderProgramIndex];
+        currentShader = usePrepass ? preSkinnedPrograms[shaderProgramIndex] : shaderPrograms[shaderProgramIndex];
     }
     
-    if (currentShader) {
+    if (currentShader && characterVisible) {
         // Set matrix for view, projection, model transformation
         currentShader->use();
         
@@ -672,7 +868,7 @@ void render(){
         currentShader->set_uniform_value("viewPos", camera.position);
         
         // if explode shader, set additional uniforms
-        if (enableExplode && explodeShader && currentShader == explodeShader) {
+        if (exploding) {
             currentShader->set_uniform_value("time", currentTime);
             currentShader->set_uniform_value("explodeStrength", explodeStrength);
         } else {
@@ -711,23 +907,52 @@ void render(){
         
         // Set texture
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, animatedModel->texture);
+        glBindTexture(GL_TEXTURE_2D, animatedModel->getAsset().texture);
         currentShader->set_uniform_value("ourTexture", 0);
         
-        // Set bone matrices for animation
-        GLint boneMatricesLocation = glGetUniformLocation(currentShader->get_program_id(), "finalBonesMatrices");
-        if (boneMatricesLocation != -1) {
-            size_t numBones = std::min((size_t)200, animatedModel->m_FinalBoneMatrices.size());
-            for (unsigned int i = 0; i < numBones; ++i) {
-                std::string name = "finalBonesMatrices[" + std::to_string(i) + "]";
-                currentShader->set_uniform_value(name.c_str(), animatedModel->m_FinalBoneMatrices[i]);
-            }
+        if (usePrepass) {
+            skinningPrepass->draw();
+        } else {
+            animatedModel->render(*bonePalette);
         }
-        
-        animatedModel->render();
         currentShader->release();
     }
 
+    // Render the crowd: instanced, posed from one of the animation textures or
+    // from the palettes evaluated in update()
+    shader_program_t* crowdShader = (crowdMode == CROWD_BONE_TEXTURE) ? batShader :
+                                    (crowdMode == CROWD_SKINNED) ? crowdSkinnedShader : vatShader;
+    if (crowdMode != CROWD_OFF && crowdSystem && crowdShader) {
+        crowdShader->use();
+        crowdShader->set_uniform_value("view", view);
+        crowdShader->set_uniform_value("projection", projection);
+        crowdShader->set_uniform_value("viewPos", camera.position);
+        crowdShader->set_uniform_value("lightPos", light.position);
+        crowdShader->set_uniform_value("lightAmbient", light.ambient);
+        crowdShader->set_uniform_value("lightDiffuse", light.diffuse);
+        crowdShader->set_uniform_value("lightSpecular", light.specular);
+        crowdShader->set_uniform_value("materialAmbient", material.ambient);
+        crowdShader->set_uniform_value("materialDiffuse", material.diffuse);
+        crowdShader->set_uniform_value("materialSpecular", material.specular);
+        crowdShader->set_uniform_value("materialShininess", material.gloss);
+        
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, animatedModel->getAsset().texture);
+        crowdShader->set_uniform_value("ourTexture", 0);
+        if (crowdMode == CROWD_BONE_TEXTURE) {
+            walkBat->bind(2);
+            walkBat->setUniforms(*crowdShader, 2);
+            crowdSystem->render(view, projection, *walkBat, *crowdShader);
+        } else if (crowdMode == CROWD_SKINNED) {
+            crowdSystem->render(*crowdShader, 2);
+        } else {
+            walkVat->bind(2);
+            walkVat->setUniforms(*crowdShader, 2);
+            crowdSystem->render(view, projection, *walkVat);
+        }
+        crowdShader->release();
+    }
+
     // Render cart (static model)
     // Render cart with motion blur effect
     if (cartModel && cartModel->vertices.size() > 0) {
@@ -867,15 +1092,46 @@ int main() {
         glfwPollEvents();
     }
 
+    const AnimationStats& animStats = animatedModel->getStats();
+    std::cout << "Animation stats: " << animStats.evaluatedUpdates << " evaluated, "
+              << animStats.skippedUpdates << " skipped updates, "
+              << animStats.paletteUploads << " palette uploads, "
+              << animStats.skippedPaletteUploads << " skipped uploads, "
+              << culledFrames << " culled frames" << std::endl;
+    const AnimationSchedulerStats& schedulerStats = animationScheduler->getStats();
+    std::cout << "Scheduler stats: " << schedulerStats.evaluations << " evaluations, "
+              << schedulerStats.interpolations << " interpolated, "
+              << schedulerStats.deferred << " deferred over budget, "
+              << schedulerStats.culled << " culled" << std::endl;
+    if (const ClipLibrary* clipLibrary = animatedAsset->getClipLibrary()) {
+        std::cout << "Clip library: " << clipLibrary->residentClips() << " of " << clipLibrary->clipCount()
+                  << " clips resident, " << clipLibrary->residentBytes() / 1024.0f << " KB" << std::endl;
+    }
+
     // cleanup
-    delete animatedModel;
+    if (crowdSystem) delete crowdSystem;
+    if (crowdWorkers) delete crowdWorkers;
+    if (walkVat) delete walkVat;
+    if (walkBat) delete walkBat;
+    if (vatShader) delete vatShader;
+    if (batShader) delete batShader;
+    if (crowdSkinnedShader) delete crowdSkinnedShader;
+    delete animationScheduler;
+    animatedAsset.reset();
+    if (bonePalette) delete bonePalette;
+    if (cpuSkinner) delete cpuSkinner;
+    if (skinningPrepass) delete skinningPrepass;
     if (explodeShader) delete explodeShader;
+    if (preSkinnedExplodeShader) delete preSkinnedExplodeShader;
     if (cartModel) delete cartModel;
     if (cityModel) delete cityModel;
     if (burningShader) delete burningShader;
     for (auto shader : shaderPrograms) {
         delete shader;
     }
+    for (auto shader : preSkinnedPrograms) {
+        delete shader;
+    }
     delete cubemapShader;
     if (staticShader) delete staticShader;
     if (cinematicDirector) delete cinematicDirector;
@@ -913,6 +1169,51 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
         std::cout << "Rain effect: " << (enableRain ? "ON" : "OFF") << std::endl;
     }
     
+    // press B key to benchmark CPU skinning on the current pose and the clip sampling kernels
+    if (key == GLFW_KEY_B && action == GLFW_PRESS && animatedModel) {
+        if (!cpuSkinner) cpuSkinner = new CpuSkinner();
+        const AnimatedModelAsset& asset = animatedModel->getAsset();
+        size_t numBones = std::min((size_t)asset.m_BoneCounter, animatedModel->m_FinalBoneMatrices.size());
+        cpuSkinner->benchmark(asset.vertices, animatedModel->m_FinalBoneMatrices.data(), numBones);
+        for (unsigned int i = 0; i < asset.getClipCount(); i++) {
+            benchmarkClipSampling(asset.acquireClip(i), asset.m_Skeleton);
+        }
+    }
+    
+    // press K key to cycle the clip sampling kernel: slerp, then the batched nlerp kernels
+    if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+        ClipSamplingKernel kernel = (ClipSamplingKernel)((getClipSamplingKernel() + 1) % CLIP_SAMPLING_KERNEL_COUNT);
+        while (!isClipSamplingKernelSupported(kernel)) {
+            kernel = (ClipSamplingKernel)((kernel + 1) % CLIP_SAMPLING_KERNEL_COUNT);
+        }
+        setClipSamplingKernel(kernel);
+        std::cout << "Clip sampling: " << clipSamplingKernelName(kernel) << std::endl;
+    }
+    
+    // press L key to cycle the skeleton LOD: automatic, then forced 0..3
+    if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        forcedSkeletonLod = (forcedSkeletonLod + 2) % (SKELETON_LOD_COUNT + 1) - 1;
+        if (forcedSkeletonLod < 0) {
+            std::cout << "Skeleton LOD: automatic" << std::endl;
+        } else {
+            std::cout << "Skeleton LOD: " << forcedSkeletonLod << " ("
+                      << animatedModel->getAsset().m_Skeleton.lodNodeCount(forcedSkeletonLod) << " nodes)" << std::endl;
+        }
+    }
+    
+    // press G key to cycle the crowd (off at start): off, vertex animation texture, bone animation texture, skinned
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        crowdMode = (crowdMode + 1) % CROWD_MODE_COUNT;
+        const char* crowdModeNames[CROWD_MODE_COUNT] = { "OFF", "vertex animation texture", "bone animation texture", "skinned" };
+        std::cout << "Crowd: " << crowdModeNames[crowdMode] << std::endl;
+    }
+    
+    // press P key to toggle the transform feedback skinning prepass
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        enableSkinningPrepass = !enableSkinningPrepass;
+        std::cout << "Skinning prepass: " << (enableSkinningPrepass ? "ON" : "OFF") << std::endl;
+    }
+    
     // press C key to start animation
     if (key == GLFW_KEY_C && action == GLFW_PRESS) {
         if (!animationStarted) {
@@ -0,0 +1,58 @@
+#include "header/mesh_cache.h"
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char kMagic[8] = { 'I', 'C', 'G', 'M', 'E', 'S', 'H', '\0' };
+const uint32_t kVersion = 1;
+// magic, version, key, payload size
+const size_t kHeaderSize = sizeof(kMagic) + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+} // namespace
+
+bool meshCacheKey(const std::string& sourcePath, uint64_t options, uint64_t& key) {
+    MappedFile source;
+    if (!source.open(sourcePath)) return false;
+    key = hashBytes(source.data(), source.size(), options);
+    return true;
+}
+
+bool writeMeshCache(const std::string& path, uint64_t key, const std::function<void(std::ostream&)>& writePayload) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "WARNING::MESH_CACHE: Cannot write " << path << std::endl;
+        return false;
+    }
+    out.write(kMagic, sizeof(kMagic));
+    writeBinary(out, kVersion);
+    writeBinary(out, key);
+    // the payload size is filled in last, a partly written file never matches it
+    std::streampos sizePosition = out.tellp();
+    writeBinary(out, (uint64_t)0);
+    writePayload(out);
+    uint64_t payloadSize = (uint64_t)out.tellp() - kHeaderSize;
+    out.seekp(sizePosition);
+    writeBinary(out, payloadSize);
+    return (bool)out;
+}
+
+bool openMeshCache(const std::string& path, uint64_t key, MappedFile& file, BinaryReader& payload) {
+    if (!file.open(path)) return false;
+
+    BinaryReader in(file.data(), file.size());
+    char magic[sizeof(kMagic)];
+    uint32_t version = 0;
+    uint64_t storedKey = 0, payloadSize = 0;
+    for (char& c : magic) in.read(c);
+    in.read(version);
+    in.read(storedKey);
+    in.read(payloadSize);
+    if (!in.ok() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion || storedKey != key ||
+        payloadSize != file.size() - kHeaderSize) {
+        file.close();
+        return false;
+    }
+    payload = BinaryReader(file.data() + kHeaderSize, (size_t)payloadSize);
+    return true;
+}
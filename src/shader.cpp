@@ -20,7 +20,7 @@ void shader_program_t::create(){
     program_handle = glCreateProgram();
 }
 
-void shader_program_t::add_shader(std::string& filepath, unsigned int type){
+void shader_program_t::add_shader(std::string& filepath, unsigned int type, const std::string& defines){
     
     // compile and add shader to program
     
@@ -38,13 +38,16 @@ void shader_program_t::add_shader(std::string& filepath, unsigned int type){
         return;
     }
 
-    std::ifstream fs(filepath);
-    std::stringstream ss;
-    std::string s;
-    while (getline(fs, s)) {
-        ss << s << "\n";
+    std::string temp = read_source(filepath);
+    if (!defines.empty()) {
+        // #version has to stay the first statement
+        size_t insertAt = 0;
+        if (temp.compare(0, 8, "#version") == 0) {
+            size_t lineEnd = temp.find('\n');
+            insertAt = (lineEnd == std::string::npos) ? temp.size() : lineEnd + 1;
+        }
+        temp.insert(insertAt, defines);
     }
-    std::string temp = ss.str();
     const char *source = temp.c_str();
 
     unsigned int shader = glCreateShader(type);
@@ -63,6 +66,23 @@ void shader_program_t::add_shader(std::string& filepath, unsigned int type){
     shader_handles.push_back(shader);
 }
 
+std::string shader_program_t::read_source(const std::string& filepath){
+    std::ifstream fs(filepath);
+    if (!fs) {
+        std::cout << "ERROR::SHADER:: Cannot read " << filepath << std::endl;
+    }
+    std::stringstream ss;
+    std::string s;
+    while (getline(fs, s)) {
+        ss << s << "\n";
+    }
+    return ss.str();
+}
+
+void shader_program_t::set_feedback_varyings(const std::vector<const char*>& varyings){
+    glTransformFeedbackVaryings(program_handle, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+}
+
 void shader_program_t::link_shader(){
 
     // attach the compiles shader to program 
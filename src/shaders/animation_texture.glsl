@@ -0,0 +1,20 @@
+// Sampling of a looping clip baked into an animation texture (see
+// AnimationTextureLayout), shared by vat.vert and the BONE_ANIMATION_TEXTURE
+// variant of skinning_common.glsl; inserted after #version by add_shader.
+
+// texel index of the texture, rows of textureSize(tex, 0).x texels
+vec4 animationTexel(sampler2D tex, int index)
+{
+    int width = textureSize(tex, 0).x;
+    return texelFetch(tex, ivec2(index % width, index / width), 0);
+}
+
+// the two frames around time and the blend between them, the clip loops and
+// the last frame blends into the first
+void animationFrames(float time, float frameRate, int frameCount, out int frame0, out int frame1, out float blend)
+{
+    float frame = mod(time * frameRate, float(frameCount));
+    frame0 = min(int(frame), frameCount - 1);
+    frame1 = (frame0 + 1) % frameCount;
+    blend = frame - float(frame0);
+}
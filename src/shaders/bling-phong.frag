@@ -6,6 +6,9 @@ out vec4 FragColor;
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
+#ifdef INSTANCE_TINT
+in vec3 Tint;                   // per crowd instance
+#endif
 
 uniform vec3 viewPos;
 uniform vec3 lightPos;
@@ -22,6 +25,9 @@ void main()
 {
     // todo3-2: get tex color
     vec3 color = texture(ourTexture, TexCoord).rgb;
+#ifdef INSTANCE_TINT
+    color *= Tint;
+#endif
     
     // get N, L, V
     vec3 N = normalize(Normal);
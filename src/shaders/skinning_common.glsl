@@ -0,0 +1,145 @@
+// Vertex inputs and skinning shared by every skinned vertex shader, inserted
+// after #version by shader_program_t::add_shader together with the defines.
+// The attribute layout matches AnimatedModelAsset::setVertexAttributes();
+// PRE_SKINNED reads the plain output of the skinning prepass instead.
+#ifdef PRE_SKINNED
+// plain vertices written by the skinning prepass
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+#else
+// packed AnimatedModelAsset vertices, see PackedVertex
+#ifdef QUANTIZED_POSITIONS
+layout (location = 0) in vec3 aQuantizedPos;     // unorm16 inside the mesh bounds
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#define aPos (positionOffset + aQuantizedPos * positionScale)
+#else
+layout (location = 0) in vec3 aPos;
+#endif
+layout (location = 1) in vec2 aOctNormal;        // octahedral, snorm16
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+#define aNormal decodeOctahedral(aOctNormal)
+#endif
+layout (location = 2) in vec2 aTexCoord;
+#ifndef BONE_INFLUENCES
+#define BONE_INFLUENCES 4                       // set by AnimatedModelAsset::shaderDefines()
+#endif
+// uint8 palette indices and unorm8 weights, sorted by weight and summing to 1
+#if BONE_INFLUENCES == 1
+layout (location = 3) in uint aBoneIDs;
+#elif BONE_INFLUENCES == 2
+layout (location = 3) in uvec2 aBoneIDs;
+layout (location = 4) in vec2 aWeights;
+#elif BONE_INFLUENCES == 4
+layout (location = 3) in uvec4 aBoneIDs;
+layout (location = 4) in vec4 aWeights;
+#else
+layout (location = 3) in uvec4 aBoneIDs;
+layout (location = 4) in vec4 aWeights;
+layout (location = 5) in uvec4 aBoneIDs2;
+layout (location = 6) in vec4 aWeights2;
+#endif
+
+#ifndef MAX_BONES
+#define MAX_BONES 256                   // set to the largest palette by BonePalette::shaderDefines()
+#endif
+
+#ifndef PRE_SKINNED
+#if defined(BONE_ANIMATION_TEXTURE) || defined(INSTANCED_PALETTE)
+// per instance, see CrowdSystem
+#define CROWD_INSTANCE
+layout (location = 7) in mat4 aInstanceModel;   // locations 7 to 10
+layout (location = 11) in float aInstanceTime;  // clip time in seconds
+layout (location = 12) in vec3 aInstanceTint;
+#define model aInstanceModel
+out vec3 Tint;
+#endif
+#ifdef BONE_ANIMATION_TEXTURE
+// palette sampled from a BoneAnimationTexture at the instance's clip time
+uniform sampler2D batTexture;
+uniform int batEntryCount;
+uniform int batFrameCount;
+uniform float batFrameRate;
+uniform int batPaletteBase;
+// needs animation_texture.glsl inserted before this file
+mat4 boneMatrix(int id)
+{
+    int frame0, frame1;
+    float blend;
+    animationFrames(aInstanceTime, batFrameRate, batFrameCount, frame0, frame1, blend);
+    int texel0 = (frame0 * batEntryCount + batPaletteBase + id) * 3;
+    int texel1 = (frame1 * batEntryCount + batPaletteBase + id) * 3;
+    vec4 row0 = mix(animationTexel(batTexture, texel0), animationTexel(batTexture, texel1), blend);
+    vec4 row1 = mix(animationTexel(batTexture, texel0 + 1), animationTexel(batTexture, texel1 + 1), blend);
+    vec4 row2 = mix(animationTexel(batTexture, texel0 + 2), animationTexel(batTexture, texel1 + 2), blend);
+    return transpose(mat4(row0, row1, row2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+#elif defined(INSTANCED_PALETTE)
+// palettes of all instances evaluated on the CPU, back to back in one texture
+// buffer, top three rows of every bone matrix
+uniform samplerBuffer instancePalettes;
+uniform int paletteEntryCount;
+uniform int paletteBase;
+mat4 boneMatrix(int id)
+{
+    int texel = (gl_InstanceID * paletteEntryCount + paletteBase + id) * 3;
+    return transpose(mat4(texelFetch(instancePalettes, texel), texelFetch(instancePalettes, texel + 1),
+                          texelFetch(instancePalettes, texel + 2), vec4(0.0, 0.0, 0.0, 1.0)));
+}
+#elif defined(BONE_PALETTE_3X4)
+// top three rows of every bone matrix
+layout (std140) uniform BonePalette {
+    vec4 boneRows[MAX_BONES * 3];
+};
+mat4 boneMatrix(int id)
+{
+    return transpose(mat4(boneRows[id * 3], boneRows[id * 3 + 1], boneRows[id * 3 + 2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
+#else
+layout (std140) uniform BonePalette {
+    mat4 finalBonesMatrices[MAX_BONES];
+};
+mat4 boneMatrix(int id)
+{
+    return finalBonesMatrices[id];
+}
+#endif
+// weighted sum of the bone matrices, unrolled per influence count
+mat4 skinMatrix()
+{
+#if BONE_INFLUENCES == 1
+    return boneMatrix(int(aBoneIDs));
+#else
+    mat4 skin = boneMatrix(int(aBoneIDs[0])) * aWeights[0];
+    for (int i = 1; i < (BONE_INFLUENCES == 8 ? 4 : BONE_INFLUENCES); i++)
+        skin += boneMatrix(int(aBoneIDs[i])) * aWeights[i];
+#if BONE_INFLUENCES == 8
+    for (int i = 0; i < 4; i++)
+        skin += boneMatrix(int(aBoneIDs2[i])) * aWeights2[i];
+#endif
+    return skin;
+#endif
+}
+#endif
+
+// Model-space position and normal of the vertex: as written by the prepass for
+// PRE_SKINNED, otherwise skinned here
+void skinnedVertex(out vec4 position, out vec3 normal)
+{
+#ifdef PRE_SKINNED
+    position = vec4(aPos, 1.0);
+    normal = aNormal;
+#else
+    // influences are sorted and normalized at import, vertices without bones
+    // point at an identity palette entry
+    mat4 skin = skinMatrix();
+    position = skin * vec4(aPos, 1.0);
+    normal = mat3(skin) * aNormal;
+#endif
+}
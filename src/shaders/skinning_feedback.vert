@@ -0,0 +1,18 @@
+#version 330 core
+// vertex inputs and skinnedVertex() come from skinning_common.glsl
+
+// captured with transform feedback, the animated_*.vert PRE_SKINNED variants read them back
+out vec3 skinnedPosition;
+out vec3 skinnedNormal;
+
+// skinning prepass: one point per vertex, rasterization is disabled
+void main()
+{
+    vec4 totalPosition;
+    vec3 totalNormal;
+    skinnedVertex(totalPosition, totalNormal);
+    
+    skinnedPosition = totalPosition.xyz;
+    skinnedNormal = totalNormal;
+    gl_Position = totalPosition;
+}
@@ -0,0 +1,45 @@
+#version 330 core
+// Characters played back from a VertexAnimationTexture: the skinned position
+// and normal of every frame are fetched by gl_VertexID, nothing is skinned here
+layout (location = 2) in vec2 aTexCoord;
+// per instance, see CrowdSystem
+layout (location = 7) in mat4 aInstanceModel;   // locations 7 to 10
+layout (location = 11) in float aInstanceTime;  // clip time in seconds
+layout (location = 12) in vec3 aInstanceTint;
+
+uniform sampler2D vatTexture;
+uniform int vatVertexCount;
+uniform int vatFrameCount;
+uniform float vatFrameRate;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoord;
+out vec3 Tint;
+
+// animationFrames() and animationTexel() come from animation_texture.glsl
+
+void main()
+{
+    int frame0, frame1;
+    float blend;
+    animationFrames(aInstanceTime, vatFrameRate, vatFrameCount, frame0, frame1, blend);
+    // texel 2 * (frame * vertexCount + vertex) is the position, the next the normal
+    int texel0 = (frame0 * vatVertexCount + gl_VertexID) * 2;
+    int texel1 = (frame1 * vatVertexCount + gl_VertexID) * 2;
+    
+    vec3 position = mix(animationTexel(vatTexture, texel0).xyz, animationTexel(vatTexture, texel1).xyz, blend);
+    vec3 normal = mix(animationTexel(vatTexture, texel0 + 1).xyz, animationTexel(vatTexture, texel1 + 1).xyz, blend);
+    
+    vec4 worldPos = aInstanceModel * vec4(position, 1.0f);
+    FragPos = worldPos.xyz;
+    // instances only rotate and scale uniformly
+    Normal = mat3(aInstanceModel) * normal;
+    TexCoord = aTexCoord;
+    Tint = aInstanceTint;
+    
+    gl_Position = projection * view * worldPos;
+}
@@ -0,0 +1,340 @@
+#include "header/skeleton.h"
+#include <iostream>
+#include <algorithm>
+
+static glm::mat4 aiToGlm(const aiMatrix4x4& from) {
+    glm::mat4 to;
+    to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
+    to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
+    to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
+    to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
+    return to;
+}
+
+void Skeleton::build(const aiNode* root, const std::map<std::string, BoneInfo>& boneInfoMap) {
+    names.clear();
+    parents.clear();
+    boneIndices.clear();
+    offsets.clear();
+    bindTranslations.clear();
+    bindRotations.clear();
+    bindScales.clear();
+    lodNodeCounts.clear();
+    lodBoneAliases.clear();
+    m_NodeLookup.clear();
+
+    if (!root) return;
+    // depth-first pre-order guarantees parents are stored before children
+    addNode(root, -1, boneInfoMap);
+    buildLods();
+
+    std::cout << "Skeleton built: " << size() << " nodes, LOD levels evaluate";
+    for (unsigned int count : lodNodeCounts) std::cout << " " << count;
+    std::cout << std::endl;
+}
+
+void Skeleton::buildLods() {
+    const size_t count = size();
+    if (count == 0) return;
+
+    // Bind-pose joint positions
+    std::vector<glm::mat4> bindGlobals(count);
+    std::vector<glm::vec3> positions(count);
+    for (size_t i = 0; i < count; i++) {
+        glm::mat4 local = composeTransform(bindTranslations[i], bindRotations[i], bindScales[i]);
+        bindGlobals[i] = parents[i] < 0 ? local : bindGlobals[parents[i]] * local;
+        positions[i] = glm::vec3(bindGlobals[i][3]);
+    }
+    glm::vec3 boundsMin = positions[0], boundsMax = positions[0];
+    for (const auto& position : positions) {
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+    float skeletonSize = std::max(glm::length(boundsMax - boundsMin), 1e-6f);
+
+    // Length of the longest chain below every node, children come after parents
+    std::vector<float> chainLengths(count, 0.0f);
+    for (size_t i = count; i-- > 1;) {
+        int parent = parents[i];
+        if (parent < 0) continue;
+        float length = chainLengths[i] + glm::length(positions[i] - positions[parent]);
+        chainLengths[parent] = std::max(chainLengths[parent], length);
+    }
+
+    // A node collapses at the first level whose threshold its chain is below,
+    // as a fraction of the skeleton size: end bones, then fingers and toes,
+    // then hands, feet and head
+    static const float kCollapseThresholds[SKELETON_LOD_COUNT] = { 0.0f, 0.01f, 0.06f, 0.12f };
+    std::vector<unsigned int> collapseLevels(count, SKELETON_LOD_COUNT);
+    for (size_t i = 0; i < count; i++) {
+        if (parents[i] < 0) continue;
+        for (unsigned int level = 1; level < SKELETON_LOD_COUNT; level++) {
+            if (chainLengths[i] <= kCollapseThresholds[level] * skeletonSize) {
+                collapseLevels[i] = level;
+                break;
+            }
+        }
+        // a collapsed bone needs a bone ancestor to copy
+        if (boneIndices[i] >= 0 && collapseLevels[i] < SKELETON_LOD_COUNT) {
+            int ancestor = parents[i];
+            while (ancestor >= 0 && boneIndices[ancestor] < 0) ancestor = parents[ancestor];
+            if (ancestor < 0) collapseLevels[i] = SKELETON_LOD_COUNT;
+        }
+    }
+    // parents are kept at least as long as their children
+    for (size_t i = count; i-- > 1;) {
+        int parent = parents[i];
+        if (parent >= 0) collapseLevels[parent] = std::max(collapseLevels[parent], collapseLevels[i]);
+    }
+
+    // Reorder the nodes by collapse level, a stable sort keeps parents first
+    std::vector<int> order(count);
+    for (size_t i = 0; i < count; i++) order[i] = (int)i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return collapseLevels[a] > collapseLevels[b];
+    });
+    std::vector<int> newIndex(count);
+    for (size_t i = 0; i < count; i++) newIndex[order[i]] = (int)i;
+
+    auto reorder = [&](auto& values) {
+        auto old = values;
+        for (size_t i = 0; i < count; i++) values[i] = old[order[i]];
+    };
+    reorder(names);
+    reorder(parents);
+    reorder(boneIndices);
+    reorder(offsets);
+    reorder(bindTranslations);
+    reorder(bindRotations);
+    reorder(bindScales);
+    reorder(collapseLevels);
+    for (auto& parent : parents) {
+        if (parent >= 0) parent = newIndex[parent];
+    }
+    for (auto& entry : m_NodeLookup) {
+        entry.second = newIndex[entry.second];
+    }
+
+    lodNodeCounts.assign(SKELETON_LOD_COUNT, 0);
+    lodBoneAliases.assign(SKELETON_LOD_COUNT, {});
+    for (unsigned int level = 0; level < SKELETON_LOD_COUNT; level++) {
+        for (size_t i = 0; i < count; i++) {
+            if (collapseLevels[i] > level) {
+                lodNodeCounts[level]++;
+                continue;
+            }
+            if (boneIndices[i] < 0) continue;
+            // nearest bone ancestor that this level still evaluates
+            int ancestor = parents[i];
+            while (collapseLevels[ancestor] <= level || boneIndices[ancestor] < 0) ancestor = parents[ancestor];
+            lodBoneAliases[level].push_back({ boneIndices[i], boneIndices[ancestor] });
+        }
+    }
+}
+
+void Skeleton::addNode(const aiNode* node, int parent, const std::map<std::string, BoneInfo>& boneInfoMap) {
+    int index = (int)parents.size();
+    std::string name = node->mName.data;
+
+    names.push_back(name);
+    parents.push_back(parent);
+    m_NodeLookup.emplace(name, index);
+
+    auto boneInfo = boneInfoMap.find(name);
+    if (boneInfo != boneInfoMap.end()) {
+        boneIndices.push_back(boneInfo->second.id);
+        offsets.push_back(boneInfo->second.offset);
+    } else {
+        boneIndices.push_back(-1);
+        offsets.push_back(glm::mat4(1.0f));
+    }
+
+    // Split the bind transform into TRS so clips and overrides can work on it directly
+    glm::mat4 transform = aiToGlm(node->mTransformation);
+    glm::vec3 scale = glm::vec3(
+        glm::length(glm::vec3(transform[0])),
+        glm::length(glm::vec3(transform[1])),
+        glm::length(glm::vec3(transform[2]))
+    );
+    glm::mat3 rotMat = glm::mat3(
+        glm::vec3(transform[0]) / scale.x,
+        glm::vec3(transform[1]) / scale.y,
+        glm::vec3(transform[2]) / scale.z
+    );
+    bindTranslations.push_back(glm::vec3(transform[3]));
+    bindRotations.push_back(glm::normalize(glm::quat_cast(rotMat)));
+    bindScales.push_back(scale);
+
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        addNode(node->mChildren[i], index, boneInfoMap);
+    }
+}
+
+void Skeleton::write(std::ostream& out) const {
+    writeBinary(out, (uint32_t)size());
+    for (const auto& name : names) writeBinaryString(out, name);
+    writeBinaryArray(out, parents);
+    writeBinaryArray(out, boneIndices);
+    writeBinaryArray(out, offsets);
+    writeBinaryArray(out, bindTranslations);
+    writeBinaryArray(out, bindRotations);
+    writeBinaryArray(out, bindScales);
+    writeBinaryArray(out, lodNodeCounts);
+    writeBinary(out, (uint32_t)lodBoneAliases.size());
+    // alias pairs as a flat (bone, kept bone) array
+    std::vector<int> flat;
+    for (const auto& aliases : lodBoneAliases) {
+        flat.clear();
+        for (const auto& alias : aliases) {
+            flat.push_back(alias.first);
+            flat.push_back(alias.second);
+        }
+        writeBinaryArray(out, flat);
+    }
+}
+
+bool Skeleton::read(BinaryReader& in) {
+    uint32_t count = 0, lodCount = 0;
+    // every name takes at least its length word
+    if (!in.read(count) || count > in.remaining() / 4) return false;
+    names.resize(count);
+    for (auto& name : names) in.readString(name);
+    in.readArray(parents);
+    in.readArray(boneIndices);
+    in.readArray(offsets);
+    in.readArray(bindTranslations);
+    in.readArray(bindRotations);
+    in.readArray(bindScales);
+    in.readArray(lodNodeCounts);
+    in.read(lodCount);
+    if (!in.ok() || lodCount > SKELETON_LOD_COUNT) return false;
+    lodBoneAliases.resize(lodCount);
+    std::vector<int> flat;
+    for (auto& aliases : lodBoneAliases) {
+        in.readArray(flat);
+        aliases.clear();
+        for (size_t i = 0; i + 1 < flat.size(); i += 2) aliases.push_back({ flat[i], flat[i + 1] });
+    }
+    if (!in.ok() || parents.size() != count || boneIndices.size() != count || offsets.size() != count ||
+        bindTranslations.size() != count || bindRotations.size() != count || bindScales.size() != count) {
+        return false;
+    }
+    // evaluation relies on parents coming first and on LOD prefixes within the nodes
+    for (uint32_t i = 0; i < count; i++) {
+        if (parents[i] < -1 || parents[i] >= (int)i || boneIndices[i] < -1) return false;
+    }
+    for (unsigned int lodNodeCount : lodNodeCounts) {
+        if (lodNodeCount > count) return false;
+    }
+    for (const auto& aliases : lodBoneAliases) {
+        for (const auto& alias : aliases) {
+            if (alias.first < 0 || alias.second < 0) return false;
+        }
+    }
+
+    m_NodeLookup.clear();
+    for (uint32_t i = 0; i < count; i++) m_NodeLookup.emplace(names[i], (int)i);
+    return true;
+}
+
+int Skeleton::findNode(const std::string& name) const {
+    auto it = m_NodeLookup.find(name);
+    return (it != m_NodeLookup.end()) ? it->second : -1;
+}
+
+void Pose::resize(size_t count) {
+    translations.resize(count);
+    rotations.resize(count);
+    scales.resize(count);
+}
+
+void Pose::setToBindPose(const Skeleton& skeleton) {
+    // same-size assignment reuses the existing storage
+    translations = skeleton.bindTranslations;
+    rotations = skeleton.bindRotations;
+    scales = skeleton.bindScales;
+}
+
+void blendPoses(const Pose* poses, const float* weights, size_t poseCount, Pose& result, size_t nodeCount) {
+    if (poseCount == 0) return;
+    
+    float totalWeight = 0.0f;
+    for (size_t k = 0; k < poseCount; k++) totalWeight += weights[k];
+    if (totalWeight <= 0.0f) return;
+    
+    result.resize(poses[0].translations.size());
+    const size_t count = std::min(nodeCount, poses[0].translations.size());
+    glm::vec3* translations = result.translations.data();
+    glm::quat* rotations = result.rotations.data();
+    glm::vec3* scales = result.scales.data();
+    
+    // one tight loop per pose over contiguous arrays
+    float w = weights[0] / totalWeight;
+    for (size_t i = 0; i < count; i++) {
+        translations[i] = poses[0].translations[i] * w;
+        rotations[i] = poses[0].rotations[i] * w;
+        scales[i] = poses[0].scales[i] * w;
+    }
+    for (size_t k = 1; k < poseCount; k++) {
+        w = weights[k] / totalWeight;
+        if (w <= 0.0f) continue;
+        const Pose& pose = poses[k];
+        for (size_t i = 0; i < count; i++) {
+            translations[i] += pose.translations[i] * w;
+            scales[i] += pose.scales[i] * w;
+            // take the short way around: q and -q are the same rotation
+            float sign = (glm::dot(poses[0].rotations[i], pose.rotations[i]) < 0.0f) ? -w : w;
+            rotations[i] += pose.rotations[i] * sign;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        rotations[i] = glm::normalize(rotations[i]);
+    }
+}
+
+glm::mat4 composeTransform(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale) {
+    // equivalent to translate * mat4_cast(rotation) * scale without the two extra matrix products
+    glm::mat3 r = glm::mat3_cast(rotation);
+    glm::mat4 m;
+    m[0] = glm::vec4(r[0] * scale.x, 0.0f);
+    m[1] = glm::vec4(r[1] * scale.y, 0.0f);
+    m[2] = glm::vec4(r[2] * scale.z, 0.0f);
+    m[3] = glm::vec4(translation, 1.0f);
+    return m;
+}
+
+void evaluateSkeleton(const Skeleton& skeleton, const Pose& pose,
+                      std::vector<glm::mat4>& globalTransforms,
+                      std::vector<glm::mat4>& finalBoneMatrices,
+                      unsigned int lod) {
+    if (globalTransforms.size() < skeleton.size()) {
+        globalTransforms.resize(skeleton.size());
+    }
+    const size_t count = skeleton.lodNodeCount(lod);
+
+    const int* parents = skeleton.parents.data();
+    const int* boneIndices = skeleton.boneIndices.data();
+    const glm::mat4* offsets = skeleton.offsets.data();
+    glm::mat4* globals = globalTransforms.data();
+
+    for (size_t i = 0; i < count; i++) {
+        glm::mat4 local = composeTransform(pose.translations[i], pose.rotations[i], pose.scales[i]);
+        int parent = parents[i];
+        globals[i] = (parent < 0) ? local : globals[parent] * local;
+
+        int boneIndex = boneIndices[i];
+        if (boneIndex >= 0 && boneIndex < (int)finalBoneMatrices.size()) {
+            finalBoneMatrices[boneIndex] = globals[i] * offsets[i];
+        }
+    }
+
+    // collapsed bones move rigidly with their kept ancestor
+    if (lod > 0 && lod < skeleton.lodBoneAliases.size()) {
+        const int paletteSize = (int)finalBoneMatrices.size();
+        for (const auto& alias : skeleton.lodBoneAliases[lod]) {
+            if (alias.first < paletteSize && alias.second < paletteSize) {
+                finalBoneMatrices[alias.first] = finalBoneMatrices[alias.second];
+            }
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#include "header/skinning_prepass.h"
+#include "header/bone_palette.h"
+#include <iostream>
+
+SkinningPrepass::SkinningPrepass(const AnimatedModelAsset& asset, const std::string& shaderDir, const std::string& paletteDefines)
+    : m_Asset(asset) {
+    std::string vpath = shaderDir + "skinning_feedback.vert";
+    m_Program.create();
+    std::string skinningCommon = shader_program_t::read_source(shaderDir + "skinning_common.glsl");
+    m_Program.add_shader(vpath, GL_VERTEX_SHADER, paletteDefines + m_Asset.shaderDefines() + skinningCommon);
+    m_Program.set_feedback_varyings({ "skinnedPosition", "skinnedNormal" });
+    m_Program.link_shader();
+    if (!BonePalette::bindProgram(m_Program.get_program_id())) {
+        std::cout << "ERROR:: Skinning prepass shader has no BonePalette block" << std::endl;
+    }
+    if (m_Asset.hasQuantizedPositions()) {
+        m_Program.use();
+        m_Program.set_uniform_value("positionOffset", m_Asset.getPositionOffset());
+        m_Program.set_uniform_value("positionScale", m_Asset.getPositionScale());
+        m_Program.release();
+    }
+    
+    glGenBuffers(1, &m_OutputBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_OutputBuffer);
+    glBufferData(GL_ARRAY_BUFFER, m_Asset.vertices.size() * sizeof(SkinnedVertex), nullptr, GL_DYNAMIC_COPY);
+    
+    // Skinned positions and normals come from the output buffer, texture
+    // coordinates and indices are shared with the asset
+    glGenVertexArrays(1, &m_SkinnedVAO);
+    glBindVertexArray(m_SkinnedVAO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, normal));
+    
+    m_Asset.setTexCoordAttribute(2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Asset.EBO);
+    
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+SkinningPrepass::~SkinningPrepass() {
+    if (m_SkinnedVAO) glDeleteVertexArrays(1, &m_SkinnedVAO);
+    if (m_OutputBuffer) glDeleteBuffers(1, &m_OutputBuffer);
+}
+
+bool SkinningPrepass::update(unsigned int paletteVersion, const BonePalette& palette) {
+    if (m_HasOutput && paletteVersion == m_LastPaletteVersion) return false;
+    if (m_Asset.vertices.empty()) return false;
+    
+    m_Program.use();
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_OutputBuffer);
+    
+    glBindVertexArray(m_Asset.VAO);
+    glBeginTransformFeedback(GL_POINTS);
+    // Submeshes are contiguous in vertex order, so the captured vertices line up
+    // with the asset's; neighbours sharing a palette go in one draw
+    const auto& submeshes = m_Asset.m_Submeshes;
+    for (size_t i = 0; i < submeshes.size();) {
+        size_t end = i + 1;
+        while (end < submeshes.size() && submeshes[end].palette == submeshes[i].palette) end++;
+        const Submesh& last = submeshes[end - 1];
+        palette.bind(submeshes[i].palette);
+        glDrawArrays(GL_POINTS, (GLint)submeshes[i].baseVertex,
+                     (GLsizei)(last.baseVertex + last.vertexCount - submeshes[i].baseVertex));
+        i = end;
+    }
+    glEndTransformFeedback();
+    glBindVertexArray(0);
+    
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    m_Program.release();
+    
+    m_LastPaletteVersion = paletteVersion;
+    m_HasOutput = true;
+    return true;
+}
+
+void SkinningPrepass::draw() const {
+    glBindVertexArray(m_SkinnedVAO);
+    m_Asset.drawSubmeshes();
+    glBindVertexArray(0);
+}
@@ -6,6 +6,15 @@
 #include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 
+namespace {
+
+// Bump the first entry when the mesh cache payload changes
+const uint32_t kMeshCacheLayout[] = { 1, (uint32_t)sizeof(StaticVertex) };
+// three colours, shininess and the texture path length
+const size_t kMinMaterialSize = 3 * sizeof(glm::vec3) + 4 + 4;
+
+} // namespace
+
 StaticModel::StaticModel(const std::string& path) {
     // load geometry plus materials immediately to keep instance usable
     loadModel(path);
@@ -30,6 +39,36 @@ void StaticModel::loadModel(const std::string& path) {
                              | aiProcess_FlipUVs 
                              | aiProcess_CalcTangentSpace;
     
+    // A mesh cache built from the same file contents and flags replaces the import
+    const std::string cachePath = path + ".meshcache";
+    uint64_t options = hashBytes(kMeshCacheLayout, sizeof(kMeshCacheLayout));
+    options = hashBytes(&importFlags, sizeof(importFlags), options);
+    uint64_t cacheKey = 0;
+    bool haveKey = meshCacheKey(path, options, cacheKey);
+    
+    std::vector<std::string> texturePaths;
+    if (haveKey && loadMeshCache(cachePath, cacheKey, texturePaths)) {
+        std::cout << "Loaded mesh cache: " << cachePath << " (OBJ import skipped)" << std::endl;
+    } else {
+        if (!importModel(path, importFlags, texturePaths)) return;
+        if (!haveKey || !saveMeshCache(cachePath, cacheKey, texturePaths)) {
+            std::cout << "WARNING::MESH_CACHE: No mesh cache, the next start imports the OBJ again" << std::endl;
+        }
+    }
+    
+    // load diffuse textures
+    for (size_t i = 0; i < materials.size(); i++) {
+        if (texturePaths[i].empty()) continue;
+        materials[i].texture = loadTextureFromFile(directory + texturePaths[i]);
+        materials[i].hasTexture = (materials[i].texture != 0);
+    }
+    
+    setupMesh();
+    
+    std::cout << "Static model processed: " << vertices.size() << " vertices, " << indices.size() << " indices" << std::endl;
+}
+
+bool StaticModel::importModel(const std::string& path, unsigned int importFlags, std::vector<std::string>& texturePaths) {
     std::cout << "Loading OBJ file: " << path << std::endl;
     m_scene = m_Importer.ReadFile(path, importFlags);
     
@@ -39,7 +78,7 @@ void StaticModel::loadModel(const std::string& path) {
             errorString = "Unknown error";
         }
         std::cout << "ERROR::STATIC_MODEL:: " << errorString << std::endl;
-        return;
+        return false;
     }
     
     std::cout << "OBJ file loaded successfully!" << std::endl;
@@ -48,6 +87,7 @@ void StaticModel::loadModel(const std::string& path) {
     
     // load materials
     materials.resize(m_scene->mNumMaterials);
+    texturePaths.assign(m_scene->mNumMaterials, std::string());
     for (unsigned int i = 0; i < m_scene->mNumMaterials; i++) {
         aiMaterial* mat = m_scene->mMaterials[i];
         Material& material = materials[i];
@@ -84,13 +124,11 @@ void StaticModel::loadModel(const std::string& path) {
             material.shininess = shininess;
         }
         
-        // load diffuse texture
+        // diffuse texture, loaded by loadModel()
         if (mat->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
             aiString str;
             mat->GetTexture(aiTextureType_DIFFUSE, 0, &str);
-            std::string texturePath = directory + str.C_Str();
-            material.texture = loadTextureFromFile(texturePath);
-            material.hasTexture = (material.texture != 0);
+            texturePaths[i] = str.C_Str();
         }
         
         std::cout << "  Material " << i << ": ambient(" << material.ambient.r << "," << material.ambient.g << "," << material.ambient.b << "), "
@@ -98,9 +136,7 @@ void StaticModel::loadModel(const std::string& path) {
     }
     
     processNode(m_scene->mRootNode, m_scene);
-    setupMesh();
-    
-    std::cout << "Static model processed: " << vertices.size() << " vertices, " << indices.size() << " indices" << std::endl;
+    return true;
 }
 
 void StaticModel::processNode(aiNode* node, const aiScene* scene) {
@@ -163,6 +199,62 @@ void StaticModel::processMesh(aiMesh* mesh, const aiScene* scene) {
     }
 }
 
+bool StaticModel::saveMeshCache(const std::string& path, uint64_t key,
+                                const std::vector<std::string>& texturePaths) const {
+    return writeMeshCache(path, key, [&](std::ostream& out) {
+        writeBinary(out, (uint32_t)materials.size());
+        for (size_t i = 0; i < materials.size(); i++) {
+            writeBinary(out, materials[i].ambient);
+            writeBinary(out, materials[i].diffuse);
+            writeBinary(out, materials[i].specular);
+            writeBinary(out, materials[i].shininess);
+            writeBinaryString(out, texturePaths[i]);
+        }
+        writeBinaryArray(out, vertices);
+        writeBinaryArray(out, indices);
+        writeBinaryArray(out, materialIndices);
+    });
+}
+
+bool StaticModel::loadMeshCache(const std::string& path, uint64_t key, std::vector<std::string>& texturePaths) {
+    MappedFile file;
+    BinaryReader in(nullptr, 0);
+    if (!openMeshCache(path, key, file, in)) return false;
+    
+    uint32_t materialCount = 0;
+    // a count the rest of the file cannot hold is garbage and is not allocated
+    bool countValid = in.read(materialCount) && materialCount <= in.remaining() / kMinMaterialSize;
+    materials.resize(countValid ? materialCount : 0);
+    texturePaths.assign(materials.size(), std::string());
+    for (size_t i = 0; i < materials.size(); i++) {
+        Material& material = materials[i];
+        in.read(material.ambient);
+        in.read(material.diffuse);
+        in.read(material.specular);
+        in.read(material.shininess);
+        in.readString(texturePaths[i]);
+        material.hasTexture = false;
+        material.texture = 0;
+    }
+    in.readArray(vertices);
+    in.readArray(indices);
+    in.readArray(materialIndices);
+    
+    bool valid = in.ok() && countValid;
+    for (unsigned int index : indices) {
+        valid = valid && index < vertices.size();
+    }
+    if (!valid) {
+        std::cout << "WARNING::MESH_CACHE: Damaged mesh cache " << path << ", importing the OBJ" << std::endl;
+        materials.clear();
+        vertices.clear();
+        indices.clear();
+        materialIndices.clear();
+        return false;
+    }
+    return true;
+}
+
 unsigned int StaticModel::loadTextureFromFile(const std::string& path) {
     // check cache first
     if (textureCache.find(path) != textureCache.end()) {
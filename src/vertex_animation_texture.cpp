@@ -0,0 +1,77 @@
+#include "header/vertex_animation_texture.h"
+#include "header/animated_model.h"
+#include "header/cpu_skinning.h"
+#include "header/animation_texture.h"
+#include <iostream>
+
+VertexAnimationTexture::VertexAnimationTexture(std::shared_ptr<const AnimatedModelAsset> asset, unsigned int clipIndex,
+                                               float frameRate, bool halfFloat)
+    : m_FrameRate(frameRate > 0.0f ? frameRate : 30.0f), m_HalfFloat(halfFloat) {
+    bake(asset, clipIndex);
+}
+
+VertexAnimationTexture::~VertexAnimationTexture() {
+    if (m_Texture) glDeleteTextures(1, &m_Texture);
+}
+
+void VertexAnimationTexture::bake(std::shared_ptr<const AnimatedModelAsset> asset, unsigned int clipIndex) {
+    if (clipIndex >= asset->getClipCount() || asset->vertices.empty()) {
+        std::cout << "ERROR::VAT:: Nothing to bake for clip " << clipIndex << std::endl;
+        return;
+    }
+    const std::vector<Vertex>& vertices = asset->vertices;
+    
+    m_VertexCount = (unsigned int)vertices.size();
+    AnimationTextureLayout layout = fitAnimationTexture(asset->getClipDuration(clipIndex), m_FrameRate,
+                                                        (size_t)m_VertexCount * 2, VAT_TEXTURE_WIDTH, "VAT");
+    m_FrameCount = layout.frameCount;
+    if (m_FrameCount == 0) return;
+    m_FrameRate = layout.frameRate;
+    m_Width = layout.width;
+    m_Height = layout.height;
+    
+    // Same pose evaluation and linear skinning as the GPU path, one frame at a time
+    AnimatedModelInstance instance(asset);
+    instance.playClip(clipIndex);
+    CpuSkinner skinner;
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec4> texelData((size_t)m_Width * m_Height, glm::vec4(0.0f));
+    m_Bounds.reset();
+    for (unsigned int frame = 0; frame < m_FrameCount; frame++) {
+        instance.updateAnimation(frame / m_FrameRate);
+        skinner.skin(vertices, instance.m_FinalBoneMatrices.data(), instance.m_FinalBoneMatrices.size(), positions, normals);
+        glm::vec4* out = &texelData[(size_t)frame * m_VertexCount * 2];
+        for (size_t v = 0; v < vertices.size(); v++) {
+            // vertices without bones stay in bind pose, like the palette's identity entry
+            bool unbound = vertices[v].m_BoneIDs[0] < 0;
+            glm::vec3 position = unbound ? vertices[v].Position : positions[v];
+            glm::vec3 normal = unbound ? vertices[v].Normal : normals[v];
+            float length = glm::length(normal);
+            out[v * 2] = glm::vec4(position, 1.0f);
+            out[v * 2 + 1] = glm::vec4(length > 0.0f ? normal / length : normal, 0.0f);
+            m_Bounds.expand(position);
+        }
+    }
+    
+    m_Texture = uploadAnimationTexture(layout, m_HalfFloat ? GL_RGBA16F : GL_RGBA32F, texelData);
+    
+    std::cout << "VAT baked: clip '" << asset->getClipName(clipIndex) << "', " << m_FrameCount << " frames at "
+              << m_FrameRate << " fps, " << m_VertexCount << " vertices, " << m_Width << "x" << m_Height << " "
+              << (m_HalfFloat ? "RGBA16F" : "RGBA32F") << " (" << textureBytes() / 1024.0f << " KB)" << std::endl;
+}
+
+void VertexAnimationTexture::bind(unsigned int unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+}
+
+void VertexAnimationTexture::setUniforms(shader_program_t& program, unsigned int unit) const {
+    program.set_uniform_value("vatTexture", (int)unit);
+    program.set_uniform_value("vatVertexCount", (int)m_VertexCount);
+    program.set_uniform_value("vatFrameCount", (int)m_FrameCount);
+    program.set_uniform_value("vatFrameRate", m_FrameRate);
+}
+
+size_t VertexAnimationTexture::textureBytes() const {
+    return (size_t)m_Width * m_Height * (m_HalfFloat ? 8 : 16);
+}
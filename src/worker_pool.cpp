@@ -0,0 +1,76 @@
+#include "header/worker_pool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int threadCount) : m_Next(0) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 1; i < threadCount; i++) {
+        m_Threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_WakeUp.notify_all();
+    for (auto& thread : m_Threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::runChunks() {
+    for (;;) {
+        size_t begin = m_Next.fetch_add(m_Grain);
+        if (begin >= m_Count) break;
+        (*m_Task)(begin, std::min(begin + m_Grain, m_Count));
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& task) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    // not worth waking anybody up for a single chunk
+    if (m_Threads.empty() || count <= grain) {
+        task(0, count);
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Task = &task;
+        m_Count = count;
+        m_Grain = grain;
+        m_Next = 0;
+        m_Busy = (unsigned int)m_Threads.size();
+        m_Generation++;
+    }
+    m_WakeUp.notify_all();
+    
+    runChunks();
+    
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Done.wait(lock, [this] { return m_Busy == 0; });
+    m_Task = nullptr;
+}
+
+void WorkerPool::workerLoop() {
+    unsigned int seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WakeUp.wait(lock, [&] { return m_Quit || m_Generation != seenGeneration; });
+            if (m_Quit) return;
+            seenGeneration = m_Generation;
+        }
+        
+        runChunks();
+        
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (--m_Busy == 0) {
+            m_Done.notify_one();
+        }
+    }
+}